@@ -9,7 +9,9 @@
 #include "driver/i2c.h"
 
 #include "i2c_helpers.h"
+#include "i2c_bus.h"
 #include "am2301b.h"
+#include "dlog.h"
 
 
 static const char *TAG = "am2301b i2c sensor";
@@ -29,7 +31,7 @@ uint8_t am2301b_init(void)
     i2c_master_write_byte(cmd, AM2301B_ADDR << 1 | WRITE_BIT, ACK_CHECK_EN);
     i2c_master_write_byte(cmd, AM2301B_STATUS_BYTE, ACK_CHECK_EN);
     i2c_master_stop(cmd);
-    ret_val = i2c_master_cmd_begin(I2C_MASTER_PORT, cmd, 1000 / portTICK_RATE_MS);
+    ret_val = i2c_bus_exec(cmd, 2);
     i2c_cmd_link_delete(cmd);
 
     if (ret_val != ESP_OK)
@@ -43,7 +45,7 @@ uint8_t am2301b_init(void)
     i2c_master_write_byte(cmd, AM2301B_ADDR << 1 | READ_BIT, ACK_CHECK_EN);
     i2c_master_read(cmd, &status_byte, 1, LAST_NACK_VAL);
     i2c_master_stop(cmd);
-    ret_val = i2c_master_cmd_begin(I2C_MASTER_PORT, cmd, 1000 / portTICK_RATE_MS);
+    ret_val = i2c_bus_exec(cmd, 2);
     i2c_cmd_link_delete(cmd);
 
     if ((status_byte & AM2301B_STATUS_OK) != AM2301B_STATUS_OK)
@@ -60,10 +62,9 @@ uint8_t am2301b_init(void)
 }
 
 
-uint8_t am2301b_trigger_measurement(char *rel_hum_buf, char *temp_buf)
+uint8_t am2301b_start_measurement(void)
 {
     int ret_val;
-    uint8_t data[7];
     uint8_t trigger[3] = {
         AM2301B_TRIG_MEAS1,
         AM2301B_TRIG_MEAS2,
@@ -79,28 +80,35 @@ uint8_t am2301b_trigger_measurement(char *rel_hum_buf, char *temp_buf)
     i2c_master_write_byte(cmd, AM2301B_ADDR << 1 | WRITE_BIT, ACK_CHECK_EN);
     i2c_master_write(cmd, trigger, 3, ACK_CHECK_EN);
     i2c_master_stop(cmd);
-    ret_val = i2c_master_cmd_begin(I2C_MASTER_PORT, cmd, 1000 / portTICK_RATE_MS);
+    ret_val = i2c_bus_exec(cmd, 4);
     i2c_cmd_link_delete(cmd);
 
     if (ret_val != ESP_OK)
     {
-        ESP_LOGI(TAG, "Data request error");
+        DLOG1(DLOG_AM2301B_REQ_ERR, ret_val);
         return I2C_FAIL;
     }
 
-    vTaskDelay(80 / portTICK_PERIOD_MS);
+    return I2C_OK;
+}
 
-    cmd = i2c_cmd_link_create();
+
+uint8_t am2301b_read_measurement(char *rel_hum_buf, char *temp_buf)
+{
+    int ret_val;
+    uint8_t data[7];
+
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
     i2c_master_start(cmd);
     i2c_master_write_byte(cmd, AM2301B_ADDR << 1 | READ_BIT, ACK_CHECK_EN);
     i2c_master_read(cmd, data, 7, LAST_NACK_VAL);
     i2c_master_stop(cmd);
-    ret_val = i2c_master_cmd_begin(I2C_MASTER_PORT, cmd, 1000 / portTICK_RATE_MS);
+    ret_val = i2c_bus_exec(cmd, 8);
     i2c_cmd_link_delete(cmd);
 
     if (ret_val != ESP_OK)
     {
-        ESP_LOGI(TAG, "Data retrieval error");
+        DLOG1(DLOG_AM2301B_READ_ERR, ret_val);
         return I2C_FAIL;
     }
 
@@ -122,3 +130,12 @@ uint8_t am2301b_trigger_measurement(char *rel_hum_buf, char *temp_buf)
 }
 
 
+uint8_t am2301b_trigger_measurement(char *rel_hum_buf, char *temp_buf)
+{
+    if (am2301b_start_measurement() != I2C_OK)
+        return I2C_FAIL;
+
+    vTaskDelay(AM2301B_MEAS_TIME_MS / portTICK_PERIOD_MS);
+
+    return am2301b_read_measurement(rel_hum_buf, temp_buf);
+}
@@ -7,6 +7,9 @@
 #define AM2301B_TRIG_MEAS2      0x33
 #define AM2301B_TRIG_MEAS3      0x00
 
+/* Time from trigger until data is ready */
+#define AM2301B_MEAS_TIME_MS    80
+
 
 /**
  * @brief Perform first time setup. This only needs to be run after a power on.
@@ -18,6 +21,31 @@
 uint8_t am2301b_init(void);
 
 
+/**
+ * @brief Send the trigger measurement command. Data can be read with
+ *      am2301b_read_measurement() after AM2301B_MEAS_TIME_MS, leaving the
+ *      bus free for other devices in between.
+ * 
+ * @return uint8_t
+ *      - I2C_OK if success
+ *      - I2C_FAIL if not
+ */
+uint8_t am2301b_start_measurement(void);
+
+
+/**
+ * @brief Read a measurement started with am2301b_start_measurement() and
+ *      write payload strings to buffers.
+ * 
+ * @param rel_hum   Where to store the relative humidity signal
+ * @param temp      Where to store the temperature output signal
+ * @return uint8_t
+ *      - I2C_OK if success
+ *      - I2C_FAIL if not
+ */
+uint8_t am2301b_read_measurement(char *rel_hum_buf, char *temp_buf);
+
+
 /**
  * @brief Trigger sensor read and write payload strings to buffers.
  * 
@@ -0,0 +1,237 @@
+#include <string.h>
+#include <stdio.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+
+#include "dlog.h"
+
+
+#define DLOG_FLUSH_MS           CONFIG_DLOG_FLUSH_MS
+#define DLOG_TASK_PRIORITY      CONFIG_DLOG_TASK_PRIORITY
+#define DLOG_RING_MASK          (DLOG_RING_SIZE - 1)
+#define DLOG_QUIET_TICKS        (DLOG_RATE_LIMIT_QUIET_MS / portTICK_PERIOD_MS)
+
+#if (DLOG_RING_SIZE & DLOG_RING_MASK) != 0
+#error "CONFIG_DLOG_RING_SIZE must be a power of two"
+#endif
+
+/* Keep the compiler from moving record stores past the ready flag */
+#define DLOG_BARRIER()          __asm__ __volatile__("" ::: "memory")
+
+
+/* Which ids are rate limited */
+#define DLOG_DEF(id, rate_limited, fmt) rate_limited,
+static const uint8_t dlog_rate_limited[DLOG_ID_COUNT] = {
+#include "dlog_ids.h"
+};
+#undef DLOG_DEF
+
+#ifdef CONFIG_DLOG_FORMAT_ON_TARGET
+static const char *TAG = "dlog";
+
+/* Format strings only end up in the image when formatting on target */
+#define DLOG_DEF(id, rate_limited, fmt) fmt,
+static const char *dlog_formats[DLOG_ID_COUNT] = {
+#include "dlog_ids.h"
+};
+#undef DLOG_DEF
+#endif
+
+/* Record ring. head and tail are free running, slot is index & mask */
+static dlog_rec_t ring[DLOG_RING_SIZE];
+static volatile uint8_t ready[DLOG_RING_SIZE];
+static uint32_t head = 0;
+static uint32_t tail = 0;
+static uint32_t dropped = 0;
+
+/* Rate limiting state, per record id */
+static uint8_t seen[DLOG_ID_COUNT];
+static uint16_t suppressed[DLOG_ID_COUNT];
+static TickType_t last_seen[DLOG_ID_COUNT];
+
+
+void dlog_write(dlog_id_t id, int32_t a0, int32_t a1, int32_t a2)
+{
+    TickType_t now = xTaskGetTickCount();
+    uint16_t repeats = 0;
+    uint32_t slot;
+
+    if (id >= DLOG_ID_COUNT)
+        return;
+
+    /* Claim a slot. This is the only shared state producers touch, so the
+     * critical section is a handful of instructions and nothing blocks. */
+    portENTER_CRITICAL();
+
+    /* After a quiet spell this is a new burst, queue it at once */
+    if (seen[id] && now - last_seen[id] >= DLOG_QUIET_TICKS)
+        seen[id] = 0;
+    last_seen[id] = now;
+
+    /* Repeats are only counted until every Nth one gets through */
+    if (dlog_rate_limited[id] && seen[id] &&
+        suppressed[id] < DLOG_RATE_LIMIT_COUNT - 1)
+    {
+        suppressed[id]++;
+
+        portEXIT_CRITICAL();
+        return;
+    }
+
+    if (head - tail >= DLOG_RING_SIZE)
+    {
+        dropped++;
+        portEXIT_CRITICAL();
+        return;
+    }
+
+    slot = head++ & DLOG_RING_MASK;
+
+    seen[id] = 1;
+    repeats = suppressed[id];
+    suppressed[id] = 0;
+
+    portEXIT_CRITICAL();
+
+    ring[slot].tick = now;
+    ring[slot].id = id;
+    ring[slot].suppressed = repeats;
+    ring[slot].args[0] = a0;
+    ring[slot].args[1] = a1;
+    ring[slot].args[2] = a2;
+
+    DLOG_BARRIER();
+    ready[slot] = 1;
+}
+
+
+static void dlog_print(const dlog_rec_t *rec)
+{
+#ifdef CONFIG_DLOG_FORMAT_ON_TARGET
+    char line[128];
+
+    snprintf(line, sizeof(line), dlog_formats[rec->id],
+        (int)rec->args[0], (int)rec->args[1], (int)rec->args[2]);
+
+    if (rec->suppressed)
+        ESP_LOGI(TAG, "(%u) %s (+%u repeats)", (unsigned)rec->tick, line, (unsigned)rec->suppressed);
+    else
+        ESP_LOGI(TAG, "(%u) %s", (unsigned)rec->tick, line);
+#else
+    /* Raw record, decoded by tools/dlog_decode.py */
+    printf("DL %x %x %x %x %x %x\n", (unsigned)rec->tick, (unsigned)rec->id,
+        (unsigned)rec->suppressed, (unsigned)rec->args[0],
+        (unsigned)rec->args[1], (unsigned)rec->args[2]);
+#endif
+}
+
+
+/**
+ * @brief Report repeats still held back for ids that have gone quiet, so
+ *      the count is not lost if the error never comes back.
+ * 
+ */
+static void dlog_flush_quiet(void)
+{
+    TickType_t now = xTaskGetTickCount();
+    dlog_rec_t rec;
+    uint16_t repeats;
+
+    for (int id = 0; id < DLOG_ID_COUNT; id++)
+    {
+        portENTER_CRITICAL();
+        repeats = 0;
+        if (seen[id] && now - last_seen[id] >= DLOG_QUIET_TICKS)
+        {
+            repeats = suppressed[id];
+            suppressed[id] = 0;
+            seen[id] = 0;
+        }
+        portEXIT_CRITICAL();
+
+        if (repeats)
+        {
+            rec.tick = now;
+            rec.id = DLOG_QUIET;
+            rec.suppressed = 0;
+            rec.args[0] = id;
+            rec.args[1] = repeats;
+            rec.args[2] = 0;
+            dlog_print(&rec);
+        }
+    }
+}
+
+
+void dlog_flush(void)
+{
+    dlog_rec_t rec;
+    uint32_t lost;
+    uint32_t slot;
+
+    portENTER_CRITICAL();
+    lost = dropped;
+    dropped = 0;
+    portEXIT_CRITICAL();
+
+    if (lost)
+    {
+        rec.tick = xTaskGetTickCount();
+        rec.id = DLOG_DROPPED;
+        rec.suppressed = 0;
+        rec.args[0] = lost;
+        rec.args[1] = 0;
+        rec.args[2] = 0;
+        dlog_print(&rec);
+    }
+
+    /* Drain records in order, stopping at one still being written */
+    while (tail != head)
+    {
+        slot = tail & DLOG_RING_MASK;
+
+        if (!ready[slot])
+            break;
+
+        DLOG_BARRIER();
+        memcpy(&rec, &ring[slot], sizeof(rec));
+        ready[slot] = 0;
+        DLOG_BARRIER();
+
+        /* Only the flushing task moves tail, the slot is free for
+         * producers now */
+        tail++;
+
+        dlog_print(&rec);
+    }
+
+    dlog_flush_quiet();
+}
+
+
+static void dlog_task(void *pvParameters)
+{
+loop:
+
+    dlog_flush();
+
+    vTaskDelay(DLOG_FLUSH_MS / portTICK_PERIOD_MS);
+
+    goto loop;
+}
+
+
+void dlog_init(void)
+{
+    xTaskCreate(
+        dlog_task,
+        "dlog task",
+        2048,
+        NULL,
+        DLOG_TASK_PRIORITY,
+        NULL
+    );
+}
@@ -0,0 +1,65 @@
+/* Deferred binary logging. Call sites only queue a record id and integer
+ * arguments; formatting and UART output happen later in a low priority
+ * task, or on the host. */
+
+#define DLOG_RING_SIZE          CONFIG_DLOG_RING_SIZE
+#define DLOG_RATE_LIMIT_COUNT   CONFIG_DLOG_RATE_LIMIT_COUNT
+#define DLOG_RATE_LIMIT_QUIET_MS CONFIG_DLOG_RATE_LIMIT_QUIET_MS
+#define DLOG_MAX_ARGS           3
+
+
+/* Record ids, see dlog_ids.h */
+#define DLOG_DEF(id, rate_limited, fmt) id,
+typedef enum dlog_id_t
+{
+#include "dlog_ids.h"
+    DLOG_ID_COUNT
+} dlog_id_t;
+#undef DLOG_DEF
+
+
+/**
+ * @brief Struct to hold a queued log record
+ * 
+ */
+typedef struct dlog_rec_t
+{
+    uint32_t tick;                  // Tick count when logged
+    uint16_t id;                    // Record id (dlog_id_t)
+    uint16_t suppressed;            // Rate-limited repeats before this one
+    int32_t args[DLOG_MAX_ARGS];    // Raw format arguments
+} dlog_rec_t;
+
+
+#define DLOG(id)                dlog_write(id, 0, 0, 0)
+#define DLOG1(id, a)            dlog_write(id, (int32_t)(a), 0, 0)
+#define DLOG2(id, a, b)         dlog_write(id, (int32_t)(a), (int32_t)(b), 0)
+#define DLOG3(id, a, b, c)      dlog_write(id, (int32_t)(a), (int32_t)(b), (int32_t)(c))
+
+
+/**
+ * @brief Start the task that drains the log ring. Records may be written
+ *      before this is called, they are printed once the task runs.
+ * 
+ */
+void dlog_init(void);
+
+
+/**
+ * @brief Print every complete record in the ring. Called periodically by
+ *      the log task, and must not run in two tasks at once.
+ * 
+ */
+void dlog_flush(void);
+
+
+/**
+ * @brief Queue a log record. Never blocks and does no formatting. Use the
+ *      DLOG() macros rather than calling this directly.
+ * 
+ * @param id    Record id
+ * @param a0    First format argument
+ * @param a1    Second format argument
+ * @param a2    Third format argument
+ */
+void dlog_write(dlog_id_t id, int32_t a0, int32_t a1, int32_t a2);
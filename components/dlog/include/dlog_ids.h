@@ -0,0 +1,39 @@
+/*
+ * Deferred log record table, included with DLOG_DEF() defined by the user.
+ *
+ * DLOG_DEF(id, rate_limited, format)
+ *
+ * Record ids are the position in this table and are decoded on the host by
+ * tools/dlog_decode.py, so only append new entries. Formats take up to
+ * three integer arguments.
+ */
+DLOG_DEF(DLOG_DROPPED,              0, "ring full, %d records dropped")
+DLOG_DEF(DLOG_AM2301B_TROUBLE,      1, "AM2301B trouble")
+DLOG_DEF(DLOG_LTR390_TROUBLE,       1, "ltr390 trouble")
+DLOG_DEF(DLOG_AM2301B_REQ_ERR,      1, "am2301b: data request error %d")
+DLOG_DEF(DLOG_AM2301B_READ_ERR,     1, "am2301b: data retrieval error %d")
+DLOG_DEF(DLOG_LTR390_I2C_ERR,       1, "ltr390: i2c error %d at step %d. Check sensor connection.")
+DLOG_DEF(DLOG_PUBLISH_FAIL,         1, "publish to topic %d failed")
+DLOG_DEF(DLOG_WIFI_RETRY,           0, "retry to connect to the AP")
+DLOG_DEF(DLOG_WIFI_CONNECT_FAIL,    0, "connect to the AP fail")
+DLOG_DEF(DLOG_WIFI_EVENT,           0, "WIFI_EVENT %d")
+DLOG_DEF(DLOG_IP_EVENT,             0, "IP_EVENT %d")
+DLOG_DEF(DLOG_UNKNOWN_EVENT,        0, "Unknown event: %d")
+DLOG_DEF(DLOG_MQTT_CONNECTED,       0, "MQTT_EVENT_CONNECTED")
+DLOG_DEF(DLOG_MQTT_DISCONNECTED,    0, "MQTT_EVENT_DISCONNECTED")
+DLOG_DEF(DLOG_MQTT_SUBSCRIBED,      0, "MQTT_EVENT_SUBSCRIBED")
+DLOG_DEF(DLOG_MQTT_UNSUBSCRIBED,    0, "MQTT_EVENT_UNSUBSCRIBED")
+DLOG_DEF(DLOG_MQTT_DATA,            0, "MQTT_EVENT_DATA")
+DLOG_DEF(DLOG_MQTT_BEFORE_CONNECT,  0, "MQTT_EVENT_BEFORE_CONNECT")
+DLOG_DEF(DLOG_MQTT_ERROR,           1, "MQTT_EVENT_ERROR")
+DLOG_DEF(DLOG_MQTT_OTHER,           0, "Other event id:%d")
+DLOG_DEF(DLOG_I2C_BUS_STATS,        0, "i2c bus: %d permille busy, %d transactions, %d errors")
+DLOG_DEF(DLOG_QUIET,                0, "record %d quiet again, %d repeats not shown")
+DLOG_DEF(DLOG_MQTTSN_RESOLVE_ERR,   1, "mqttsn: could not resolve gateway")
+DLOG_DEF(DLOG_MQTTSN_SOCKET_ERR,    1, "mqttsn: socket errno %d")
+DLOG_DEF(DLOG_MQTTSN_CONNECT_ERR,   1, "mqttsn: connect errno %d")
+DLOG_DEF(DLOG_MQTTSN_SEND_ERR,      1, "mqttsn: send errno %d")
+DLOG_DEF(DLOG_MQTTSN_NO_CONNACK,    1, "mqttsn: no CONNACK from gateway")
+DLOG_DEF(DLOG_MQTTSN_CONN_REJECTED, 1, "mqttsn: CONNECT rejected, rc %d")
+DLOG_DEF(DLOG_MQTTSN_PUB_REJECTED,  1, "mqttsn: PUBLISH rejected, rc %d")
+DLOG_DEF(DLOG_OTA_CHUNK_DROPPED,    1, "ota: chunk dropped, queue full or out of memory")
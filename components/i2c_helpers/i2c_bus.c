@@ -0,0 +1,106 @@
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "driver/i2c.h"
+
+#include "esp_timer.h"
+
+#include "i2c_helpers.h"
+#include "i2c_bus.h"
+
+
+/* Serialises transactions from all drivers and tasks */
+static SemaphoreHandle_t bus_mutex = NULL;
+
+static i2c_bus_stats_t stats;
+static int64_t window_start;
+
+
+/**
+ * @brief Timeout for a transfer, from the wire time at the configured clock
+ *      rate plus a fixed margin for clock stretching and scheduling.
+ * 
+ */
+static TickType_t i2c_bus_timeout(size_t xfer_bytes)
+{
+    /* 9 clocks per byte, plus start, repeated start and stop */
+    uint32_t bits = xfer_bytes * 9 + 3;
+    uint32_t wire_ms = (bits * 1000 + I2C_BUS_CLK_HZ - 1) / I2C_BUS_CLK_HZ;
+
+    return (wire_ms + I2C_BUS_MARGIN_MS) / portTICK_PERIOD_MS + 1;
+}
+
+
+void i2c_bus_init(void)
+{
+    i2c_config_t config = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = I2C_MASTER_SDA_IO,
+        .scl_io_num = I2C_MASTER_SCL_IO,
+#ifdef CONFIG_I2C_BUS_PULLUP
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+#else
+        .sda_pullup_en = GPIO_PULLUP_DISABLE,
+        .scl_pullup_en = GPIO_PULLUP_DISABLE,
+#endif
+        .clk_stretch_tick = I2C_BUS_CLK_STRETCH,
+    };
+
+    ESP_ERROR_CHECK(i2c_driver_install(I2C_MASTER_PORT, config.mode));
+    ESP_ERROR_CHECK(i2c_param_config(I2C_MASTER_PORT, &config));
+
+    window_start = esp_timer_get_time();
+
+    bus_mutex = xSemaphoreCreateMutex();
+}
+
+
+int i2c_bus_exec(i2c_cmd_handle_t cmd, size_t xfer_bytes)
+{
+    int64_t start;
+    int ret;
+
+    xSemaphoreTake(bus_mutex, portMAX_DELAY);
+
+    start = esp_timer_get_time();
+    ret = i2c_master_cmd_begin(I2C_MASTER_PORT, cmd, i2c_bus_timeout(xfer_bytes));
+
+    stats.busy_us += esp_timer_get_time() - start;
+    stats.transactions++;
+    stats.bytes += xfer_bytes;
+    if (ret != ESP_OK)
+    {
+        stats.errors++;
+        if (ret == ESP_ERR_TIMEOUT)
+            stats.timeouts++;
+    }
+
+    xSemaphoreGive(bus_mutex);
+
+    return ret;
+}
+
+
+void i2c_bus_get_stats(i2c_bus_stats_t *out)
+{
+    int64_t now = esp_timer_get_time();
+
+    xSemaphoreTake(bus_mutex, portMAX_DELAY);
+    memcpy(out, &stats, sizeof(stats));
+    memset(&stats, 0, sizeof(stats));
+    out->window_us = now - window_start;
+    window_start = now;
+    xSemaphoreGive(bus_mutex);
+}
+
+
+uint32_t i2c_bus_utilization(const i2c_bus_stats_t *s)
+{
+    if (s->window_us <= 0)
+        return 0;
+
+    return (uint32_t)(s->busy_us * 1000 / s->window_us);
+}
@@ -1,9 +1,12 @@
+#include <stdio.h>
+
 #include "freertos/FreeRTOS.h"
 #include "driver/i2c.h"
 
 #include "esp_log.h"
 
 #include "i2c_helpers.h"
+#include "i2c_bus.h"
 
 
 uint8_t i2c_write_buf(uint8_t address, uint8_t *tx_buf, size_t buf_len)
@@ -16,7 +19,7 @@ uint8_t i2c_write_buf(uint8_t address, uint8_t *tx_buf, size_t buf_len)
     i2c_master_write(cmd, tx_buf, buf_len, ACK_CHECK_EN);
     i2c_master_stop(cmd);
 
-    ret_val = i2c_master_cmd_begin(I2C_MASTER_PORT, cmd, 1000 / portTICK_RATE_MS);
+    ret_val = i2c_bus_exec(cmd, 1 + buf_len);
 
     i2c_cmd_link_delete(cmd);
 
@@ -34,7 +37,7 @@ uint8_t i2c_write_byte(uint8_t addr, uint8_t reg_addr, uint8_t reg_cmd)
     i2c_master_write_byte(cmd, reg_addr, ACK_CHECK_EN);
     i2c_master_write_byte(cmd, reg_cmd, ACK_CHECK_EN);
     i2c_master_stop(cmd);
-    ret_val = i2c_master_cmd_begin(I2C_MASTER_PORT, cmd, 1000 / portTICK_RATE_MS);
+    ret_val = i2c_bus_exec(cmd, 3);
     i2c_cmd_link_delete(cmd);
 
     return ret_val;
@@ -66,7 +69,7 @@ uint8_t i2c_read_byte(uint8_t address, uint8_t reg_addr, uint8_t *rx_reg)
     i2c_master_stop(cmd);
 
     /* Send queued commands */
-    ret_val = i2c_master_cmd_begin(I2C_MASTER_PORT, cmd, 1000 / portTICK_RATE_MS);
+    ret_val = i2c_bus_exec(cmd, 4);
 
     /* Free command link */
     i2c_cmd_link_delete(cmd);
@@ -78,9 +81,17 @@ uint8_t i2c_read_byte(uint8_t address, uint8_t reg_addr, uint8_t *rx_reg)
 void dbl2str(const double d, char *buf)
 {
     int whole, dec;
-    
-    whole = (int)d;
-    dec = (d - whole) * 1000000;
+    double mag = d < 0 ? -d : d;
+
+    /* Format the magnitude so the fraction never picks up a sign */
+    whole = (int)mag;
+    dec = (int)((mag - whole) * 1000000 + 0.5);
+
+    if (dec >= 1000000)
+    {
+        whole++;
+        dec -= 1000000;
+    }
 
-    sprintf(buf, "%d.%06d", whole, dec);
+    sprintf(buf, "%s%d.%06d", d < 0 ? "-" : "", whole, dec);
 }
@@ -0,0 +1,57 @@
+#define I2C_BUS_CLK_HZ          CONFIG_I2C_BUS_CLK_HZ
+#define I2C_BUS_CLK_STRETCH     CONFIG_I2C_BUS_CLK_STRETCH_TICK
+#define I2C_BUS_MARGIN_MS       CONFIG_I2C_BUS_TIMEOUT_MARGIN_MS
+
+
+/**
+ * @brief Struct to hold bus utilization counters
+ * 
+ */
+typedef struct i2c_bus_stats_t
+{
+    uint32_t transactions;  // Transactions run
+    uint32_t errors;        // Transactions that failed
+    uint32_t timeouts;      // Failures that were timeouts
+    uint32_t bytes;         // Bytes on the wire, including address bytes
+    int64_t busy_us;        // Time spent running transactions
+    int64_t window_us;      // Length of the measurement window
+} i2c_bus_stats_t;
+
+
+/**
+ * @brief Install the I2C driver on I2C_MASTER_PORT. All transactions must
+ *      go through i2c_bus_exec() afterwards.
+ * 
+ */
+void i2c_bus_init(void);
+
+
+/**
+ * @brief Run a command link on the bus. Transactions from different tasks
+ *      are serialised, each with a timeout sized to its length.
+ * 
+ * @param cmd           Command link to run
+ * @param xfer_bytes    Bytes on the wire, including address bytes. Used to
+ *                      size the timeout.
+ * @return int
+ *      - ESP_OK if success
+ *      - esp_err_t from the driver if not
+ */
+int i2c_bus_exec(i2c_cmd_handle_t cmd, size_t xfer_bytes);
+
+
+/**
+ * @brief Copy the utilization counters and start a new window.
+ * 
+ * @param stats Where to store the counters
+ */
+void i2c_bus_get_stats(i2c_bus_stats_t *stats);
+
+
+/**
+ * @brief Bus utilization over a stats window, in permille.
+ * 
+ * @param stats Counters from i2c_bus_get_stats()
+ * @return uint32_t
+ */
+uint32_t i2c_bus_utilization(const i2c_bus_stats_t *stats);
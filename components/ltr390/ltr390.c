@@ -11,9 +11,7 @@
 
 #include "i2c_helpers.h"
 #include "ltr390.h"
-
-
-static const char *TAG = "ltr390 i2c sensor";
+#include "dlog.h"
 
 
 uint8_t ltr390_trigger_measurement(char *als_buf, char *uvs_buf)
@@ -31,7 +29,7 @@ uint8_t ltr390_trigger_measurement(char *als_buf, char *uvs_buf)
     ret_val = i2c_write_byte(LTR390_ADDR, LTR390_MAIN_CTRL, MAIN_CTRL_EN | MAIN_CTRL_MODE_ALS);
     if (ret_val != I2C_OK)
     {
-        ESP_LOGI(TAG, "error in %s: %d. Check sensor connection.", __func__, ret_val);
+        DLOG2(DLOG_LTR390_I2C_ERR, ret_val, 1);
         return I2C_FAIL;
     }
 
@@ -42,21 +40,21 @@ uint8_t ltr390_trigger_measurement(char *als_buf, char *uvs_buf)
     ret_val = i2c_read_byte(LTR390_ADDR, LTR390_ALS_DATA0, &als_data0);
     if (ret_val != I2C_OK)
     {
-        ESP_LOGI(TAG, "error in %s: %d. Check sensor connection.", __func__, ret_val);
+        DLOG2(DLOG_LTR390_I2C_ERR, ret_val, 2);
         return I2C_FAIL;
     }
 
     ret_val = i2c_read_byte(LTR390_ADDR, LTR390_ALS_DATA1, &als_data1);
     if (ret_val != I2C_OK)
     {
-        ESP_LOGI(TAG, "error in %s: %d. Check sensor connection.", __func__, ret_val);
+        DLOG2(DLOG_LTR390_I2C_ERR, ret_val, 3);
         return I2C_FAIL;
     }
 
     ret_val = i2c_read_byte(LTR390_ADDR, LTR390_ALS_DATA2, &als_data2);
     if (ret_val != I2C_OK)
     {
-        ESP_LOGI(TAG, "error in %s: %d. Check sensor connection.", __func__, ret_val);
+        DLOG2(DLOG_LTR390_I2C_ERR, ret_val, 4);
         return I2C_FAIL;
     }
 
@@ -65,7 +63,7 @@ uint8_t ltr390_trigger_measurement(char *als_buf, char *uvs_buf)
     ret_val = i2c_write_byte(LTR390_ADDR, LTR390_MAIN_CTRL, MAIN_CTRL_EN | MAIN_CTRL_MODE_UVS);
     if (ret_val != I2C_OK)
     {
-        ESP_LOGI(TAG, "error in %s: %d. Check sensor connection.", __func__, ret_val);
+        DLOG2(DLOG_LTR390_I2C_ERR, ret_val, 5);
         return I2C_FAIL;
     }
 
@@ -76,21 +74,21 @@ uint8_t ltr390_trigger_measurement(char *als_buf, char *uvs_buf)
     ret_val = i2c_read_byte(LTR390_ADDR, LTR390_UVS_DATA0, &uvs_data0);
     if (ret_val != I2C_OK)
     {
-        ESP_LOGI(TAG, "error in %s: %d. Check sensor connection.", __func__, ret_val);
+        DLOG2(DLOG_LTR390_I2C_ERR, ret_val, 6);
         return I2C_FAIL;
     }
 
     ret_val = i2c_read_byte(LTR390_ADDR, LTR390_UVS_DATA1, &uvs_data1);
     if (ret_val != I2C_OK)
     {
-        ESP_LOGI(TAG, "error in %s: %d. Check sensor connection.", __func__, ret_val);
+        DLOG2(DLOG_LTR390_I2C_ERR, ret_val, 7);
         return I2C_FAIL;
     }
 
     ret_val = i2c_read_byte(LTR390_ADDR, LTR390_UVS_DATA2, &uvs_data2);
     if (ret_val != I2C_OK)
     {
-        ESP_LOGI(TAG, "error in %s: %d. Check sensor connection.", __func__, ret_val);
+        DLOG2(DLOG_LTR390_I2C_ERR, ret_val, 8);
         return I2C_FAIL;
     }
 
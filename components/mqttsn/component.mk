@@ -0,0 +1,6 @@
+#
+# Only built when MQTT-SN is the selected publishing transport.
+#
+ifndef CONFIG_PUBLISH_TRANSPORT_MQTTSN
+COMPONENT_OBJS :=
+endif
@@ -0,0 +1,84 @@
+/* MQTT-SN v1.2 message types */
+#define MQTTSN_CONNECT          0x04
+#define MQTTSN_CONNACK          0x05
+#define MQTTSN_PUBLISH          0x0c
+#define MQTTSN_PUBACK           0x0d
+#define MQTTSN_PINGREQ          0x16
+#define MQTTSN_PINGRESP         0x17
+#define MQTTSN_DISCONNECT       0x18
+
+/* PUBLISH flag bits */
+#define MQTTSN_FLAG_DUP         0x1 << 7
+#define MQTTSN_FLAG_QOS_0       0x0 << 5
+#define MQTTSN_FLAG_QOS_1       0x1 << 5
+#define MQTTSN_FLAG_QOS_M1      0x3 << 5
+#define MQTTSN_FLAG_CLEAN       0x1 << 2
+#define MQTTSN_TOPIC_PREDEF     0x1
+
+#define MQTTSN_PROTOCOL_ID      0x01
+#define MQTTSN_RC_ACCEPTED      0x00
+
+#define MQTTSN_PUB_HDR_LEN      7
+#define MQTTSN_MAX_PACKET       128
+#define MQTTSN_MAX_PAYLOAD      (MQTTSN_MAX_PACKET - MQTTSN_PUB_HDR_LEN)
+
+/* Publish QoS levels supported by this client */
+#define MQTTSN_QOS_FIRE_FORGET  -1
+#define MQTTSN_QOS_AT_LEAST_1   1
+
+#define MQTTSN_OK               0
+#define MQTTSN_FAIL             -1
+
+
+/**
+ * @brief Pre-serialised PUBLISH header for a pre-registered topic.
+ *      Only the message id and length change between publishes.
+ * 
+ */
+typedef struct mqttsn_topic_t
+{
+    uint8_t hdr[MQTTSN_PUB_HDR_LEN];    // Length, type, flags, topic id, msg id
+    int8_t qos;                         // MQTTSN_QOS_FIRE_FORGET or MQTTSN_QOS_AT_LEAST_1
+} mqttsn_topic_t;
+
+
+/**
+ * @brief Open the UDP socket to the gateway. With QoS 1 a session is
+ *      also set up with CONNECT, QoS -1 needs no session at all. On
+ *      failure mqttsn_publish() tries again.
+ * 
+ * @param host      Gateway host name or address
+ * @param port      Gateway UDP port
+ * @param client_id Client id sent in CONNECT
+ * @param qos       MQTTSN_QOS_FIRE_FORGET or MQTTSN_QOS_AT_LEAST_1
+ * @return int 
+ *      - MQTTSN_OK if success
+ *      - MQTTSN_FAIL if not
+ */
+int mqttsn_init(const char *host, uint16_t port, const char *client_id, int8_t qos);
+
+
+/**
+ * @brief Fill in the PUBLISH template for a pre-registered topic id.
+ * 
+ * @param topic     Template to fill in
+ * @param topic_id  Pre-defined topic id, as configured on the gateway
+ * @param qos       MQTTSN_QOS_FIRE_FORGET or MQTTSN_QOS_AT_LEAST_1
+ */
+void mqttsn_topic_init(mqttsn_topic_t *topic, uint16_t topic_id, int8_t qos);
+
+
+/**
+ * @brief Publish a payload as a single datagram. With QoS 1 wait for the
+ *      PUBACK and retransmit on timeout. Re-opens the socket if it could
+ *      not be opened before, and checks the session with PINGREQ when it
+ *      has been idle for the keep-alive period.
+ * 
+ * @param topic     Topic template from mqttsn_topic_init()
+ * @param payload   Payload bytes
+ * @param len       Payload length, at most MQTTSN_MAX_PAYLOAD
+ * @return int 
+ *      - MQTTSN_OK if success
+ *      - MQTTSN_FAIL if not
+ */
+int mqttsn_publish(mqttsn_topic_t *topic, const char *payload, size_t len);
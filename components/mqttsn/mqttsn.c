@@ -0,0 +1,308 @@
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+
+#include "mqttsn.h"
+#include "dlog.h"
+
+
+#define MQTTSN_KEEPALIVE_S      CONFIG_MQTTSN_KEEPALIVE_S
+#define MQTTSN_RETRY_TIMEOUT_MS CONFIG_MQTTSN_RETRY_TIMEOUT_MS
+#define MQTTSN_MAX_RETRY        3
+
+/* PUBACK came back with a non-zero return code */
+#define MQTTSN_REJECTED         -2
+
+
+/* UDP socket connected to the gateway, -1 until it could be opened */
+static int sock = -1;
+
+/* Gateway, client id and QoS, kept to re-open the socket and session */
+static const char *s_host;
+static uint16_t s_port;
+static const char *s_client_id;
+static int8_t s_qos;
+static uint8_t s_connected = 0;
+
+/* Last time the gateway heard from us, for the keep-alive */
+static TickType_t s_last_tx;
+
+static uint16_t msg_id = 0;
+
+/* Outgoing datagram buffer */
+static uint8_t tx_buf[MQTTSN_MAX_PACKET];
+
+
+static int mqttsn_connect(void)
+{
+    uint8_t rx[3];
+    size_t id_len = strlen(s_client_id);
+    size_t len = 6 + id_len;
+    int n;
+
+    if (len > MQTTSN_MAX_PACKET)
+        return MQTTSN_FAIL;
+
+    tx_buf[0] = len;
+    tx_buf[1] = MQTTSN_CONNECT;
+    tx_buf[2] = MQTTSN_FLAG_CLEAN;
+    tx_buf[3] = MQTTSN_PROTOCOL_ID;
+    tx_buf[4] = MQTTSN_KEEPALIVE_S >> 8;
+    tx_buf[5] = MQTTSN_KEEPALIVE_S & 0xff;
+    memcpy(&tx_buf[6], s_client_id, id_len);
+
+    for (int i = 0; i < MQTTSN_MAX_RETRY; i++)
+    {
+        if (send(sock, tx_buf, len, 0) < 0)
+        {
+            DLOG1(DLOG_MQTTSN_SEND_ERR, errno);
+            return MQTTSN_FAIL;
+        }
+
+        n = recv(sock, rx, sizeof(rx), 0);
+        if (n == 3 && rx[1] == MQTTSN_CONNACK)
+        {
+            if (rx[2] != MQTTSN_RC_ACCEPTED)
+            {
+                DLOG1(DLOG_MQTTSN_CONN_REJECTED, rx[2]);
+                return MQTTSN_FAIL;
+            }
+
+            s_connected = 1;
+            s_last_tx = xTaskGetTickCount();
+            return MQTTSN_OK;
+        }
+    }
+
+    DLOG(DLOG_MQTTSN_NO_CONNACK);
+    return MQTTSN_FAIL;
+}
+
+
+/**
+ * @brief Check the session is still alive with PINGREQ/PINGRESP.
+ * 
+ */
+static int mqttsn_ping(void)
+{
+    uint8_t ping[2] = { 2, MQTTSN_PINGREQ };
+    uint8_t rx[2];
+    int n;
+
+    for (int i = 0; i < MQTTSN_MAX_RETRY; i++)
+    {
+        if (send(sock, ping, sizeof(ping), 0) < 0)
+            return MQTTSN_FAIL;
+
+        while ((n = recv(sock, rx, sizeof(rx), 0)) > 0)
+        {
+            if (n >= 2 && rx[1] == MQTTSN_PINGRESP)
+            {
+                s_last_tx = xTaskGetTickCount();
+                return MQTTSN_OK;
+            }
+        }
+    }
+
+    return MQTTSN_FAIL;
+}
+
+
+/**
+ * @brief Resolve the gateway and open the UDP socket, then set up the
+ *      session for QoS 1. Safe to call again after a failure.
+ * 
+ */
+static int mqttsn_open(void)
+{
+    struct addrinfo hints = {
+        .ai_family = AF_INET,
+        .ai_socktype = SOCK_DGRAM,
+    };
+    struct addrinfo *res;
+    char port_str[6];
+
+    snprintf(port_str, sizeof(port_str), "%u", s_port);
+
+    if (getaddrinfo(s_host, port_str, &hints, &res) != 0 || res == NULL)
+    {
+        DLOG(DLOG_MQTTSN_RESOLVE_ERR);
+        return MQTTSN_FAIL;
+    }
+
+    sock = socket(res->ai_family, res->ai_socktype, 0);
+    if (sock < 0)
+    {
+        freeaddrinfo(res);
+        DLOG1(DLOG_MQTTSN_SOCKET_ERR, errno);
+        return MQTTSN_FAIL;
+    }
+
+    /* Connected UDP socket, so send()/recv() only talk to the gateway */
+    if (connect(sock, res->ai_addr, res->ai_addrlen) != 0)
+    {
+        freeaddrinfo(res);
+        DLOG1(DLOG_MQTTSN_CONNECT_ERR, errno);
+        close(sock);
+        sock = -1;
+        return MQTTSN_FAIL;
+    }
+    freeaddrinfo(res);
+
+    struct timeval tv = {
+        .tv_sec = MQTTSN_RETRY_TIMEOUT_MS / 1000,
+        .tv_usec = (MQTTSN_RETRY_TIMEOUT_MS % 1000) * 1000,
+    };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    /* QoS -1 publishes to pre-defined topics need no session */
+    if (s_qos == MQTTSN_QOS_FIRE_FORGET)
+        return MQTTSN_OK;
+
+    return mqttsn_connect();
+}
+
+
+int mqttsn_init(const char *host, uint16_t port, const char *client_id, int8_t qos)
+{
+    s_host = host;
+    s_port = port;
+    s_client_id = client_id;
+    s_qos = qos;
+
+    return mqttsn_open();
+}
+
+
+void mqttsn_topic_init(mqttsn_topic_t *topic, uint16_t topic_id, int8_t qos)
+{
+    topic->qos = qos;
+
+    topic->hdr[0] = 0;
+    topic->hdr[1] = MQTTSN_PUBLISH;
+    topic->hdr[2] = MQTTSN_TOPIC_PREDEF |
+        (qos == MQTTSN_QOS_FIRE_FORGET ? MQTTSN_FLAG_QOS_M1 : MQTTSN_FLAG_QOS_1);
+    topic->hdr[3] = topic_id >> 8;
+    topic->hdr[4] = topic_id & 0xff;
+    topic->hdr[5] = 0;
+    topic->hdr[6] = 0;
+}
+
+
+/**
+ * @brief Send the QoS 1 PUBLISH in tx_buf and wait for its PUBACK,
+ *      retransmitting with DUP set on timeout.
+ * 
+ */
+static int mqttsn_send_qos1(size_t pkt_len)
+{
+    uint8_t rx[7];
+    int n;
+
+    /* Message id 0 is reserved */
+    if (++msg_id == 0)
+        msg_id = 1;
+
+    tx_buf[2] &= ~(MQTTSN_FLAG_DUP);
+    tx_buf[5] = msg_id >> 8;
+    tx_buf[6] = msg_id & 0xff;
+
+    for (int i = 0; i < MQTTSN_MAX_RETRY; i++)
+    {
+        if (send(sock, tx_buf, pkt_len, 0) < 0)
+            return MQTTSN_FAIL;
+
+        /* Drain datagrams until our PUBACK or the receive timeout */
+        while ((n = recv(sock, rx, sizeof(rx), 0)) > 0)
+        {
+            if (n != 7 || rx[1] != MQTTSN_PUBACK)
+                continue;
+
+            if (((rx[4] << 8) | rx[5]) != msg_id)
+                continue;
+
+            if (rx[6] != MQTTSN_RC_ACCEPTED)
+            {
+                DLOG1(DLOG_MQTTSN_PUB_REJECTED, rx[6]);
+                return MQTTSN_REJECTED;
+            }
+
+            s_last_tx = xTaskGetTickCount();
+            return MQTTSN_OK;
+        }
+
+        tx_buf[2] |= MQTTSN_FLAG_DUP;
+    }
+
+    return MQTTSN_FAIL;
+}
+
+
+int mqttsn_publish(mqttsn_topic_t *topic, const char *payload, size_t len)
+{
+    size_t pkt_len = MQTTSN_PUB_HDR_LEN + len;
+    int ret = MQTTSN_FAIL;
+
+    if (len > MQTTSN_MAX_PAYLOAD)
+        return MQTTSN_FAIL;
+
+    /* Gateway was not reachable before, e.g. WiFi or DNS not up at boot */
+    if (sock < 0 && mqttsn_open() != MQTTSN_OK)
+        return MQTTSN_FAIL;
+
+    /* Copy the template and patch in the length */
+    memcpy(tx_buf, topic->hdr, MQTTSN_PUB_HDR_LEN);
+    memcpy(&tx_buf[MQTTSN_PUB_HDR_LEN], payload, len);
+    tx_buf[0] = pkt_len;
+
+    if (topic->qos == MQTTSN_QOS_FIRE_FORGET)
+    {
+        if (send(sock, tx_buf, pkt_len, 0) < 0)
+            return MQTTSN_FAIL;
+
+        return MQTTSN_OK;
+    }
+
+    /* Quiet for a whole keep-alive, check the session before relying on it */
+    if (s_connected &&
+        xTaskGetTickCount() - s_last_tx >= MQTTSN_KEEPALIVE_S * 1000 / portTICK_PERIOD_MS &&
+        mqttsn_ping() != MQTTSN_OK)
+        s_connected = 0;
+
+    /* A rejected PUBLISH usually means the gateway dropped the session,
+     * set it up again and retry once */
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        if (!s_connected)
+        {
+            /* CONNECT uses tx_buf too */
+            if (mqttsn_connect() != MQTTSN_OK)
+                return MQTTSN_FAIL;
+
+            memcpy(tx_buf, topic->hdr, MQTTSN_PUB_HDR_LEN);
+            memcpy(&tx_buf[MQTTSN_PUB_HDR_LEN], payload, len);
+            tx_buf[0] = pkt_len;
+        }
+
+        ret = mqttsn_send_qos1(pkt_len);
+        if (ret != MQTTSN_REJECTED)
+            break;
+
+        s_connected = 0;
+    }
+
+    if (ret != MQTTSN_OK)
+    {
+        /* Force a new CONNECT before the next publish */
+        s_connected = 0;
+        return MQTTSN_FAIL;
+    }
+
+    return MQTTSN_OK;
+}
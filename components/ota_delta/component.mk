@@ -0,0 +1,6 @@
+#
+# Only built when delta OTA updates are enabled.
+#
+ifndef CONFIG_OTA_DELTA_ENABLE
+COMPONENT_OBJS :=
+endif
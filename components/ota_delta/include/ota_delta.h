@@ -0,0 +1,64 @@
+/*
+ * Delta patch format, all integers little endian:
+ *
+ *  Header  "ADP2", new image size (u32), new image SHA-256 (32 bytes),
+ *          base image size (u32), base image SHA-256 (32 bytes),
+ *          HMAC-SHA256 of the preceding 76 bytes (32 bytes)
+ *  Ops     OTA_DELTA_OP_COPY   src offset (u32), length (u32)
+ *          OTA_DELTA_OP_INSERT length (u32), literal bytes
+ *
+ * COPY takes bytes from the running image, INSERT takes them from the
+ * patch. The patch ends when new image size bytes have been written.
+ *
+ * The hashes alone only catch corruption, anyone who can publish to the
+ * patch topic could send matching ones. The HMAC is keyed with
+ * CONFIG_OTA_DELTA_KEY, so only a holder of the key can start an update,
+ * and the new image hash it covers then authenticates the whole patch.
+ *
+ * Over MQTT each chunk is a sequence number (u32) followed by patch bytes.
+ * Chunks are applied strictly in order, anything else is dropped and the
+ * next expected sequence number is acked so the sender can resend from
+ * there. Sequence number 0 starts an update, or restarts it if the header
+ * differs from the one in progress. Once an image is verified every chunk
+ * is ignored until the restart.
+ *
+ * Each chunk is answered on the status topic with "ack <next expected>
+ * <received>", "done" or "error". Echoing the received sequence number
+ * lets the sender tell a late copy of a chunk already applied, which
+ * needs no resend, from a gap.
+ */
+
+#define OTA_DELTA_MAGIC         "ADP2"
+#define OTA_DELTA_HDR_LEN       108
+#define OTA_DELTA_MAC_OFFSET    76
+#define OTA_DELTA_SEQ_LEN       4
+
+#define OTA_DELTA_OP_COPY       0x01
+#define OTA_DELTA_OP_INSERT     0x02
+
+/* Chunk of the running image read at a time for COPY and hashing */
+#define OTA_DELTA_COPY_BUF      256
+
+#define OTA_DELTA_IDLE          0
+#define OTA_DELTA_IN_PROGRESS   1
+#define OTA_DELTA_DONE          2
+#define OTA_DELTA_FAIL          -1
+
+
+/**
+ * @brief Feed one MQTT chunk into the update. Uses a fixed amount of RAM
+ *      whatever the patch size. When the last byte is written the new
+ *      image is hashed, and the boot partition is switched only if it
+ *      matches the header.
+ * 
+ * @param data      Chunk payload, sequence number then patch bytes
+ * @param len       Payload length
+ * @param next_seq  Where to store the next expected sequence number
+ * @return int
+ *      - OTA_DELTA_IDLE if no update is running and the chunk was dropped
+ *      - OTA_DELTA_IN_PROGRESS if more chunks are expected
+ *      - OTA_DELTA_DONE if the image is verified and will boot next, for
+ *        this and every later chunk until the restart
+ *      - OTA_DELTA_FAIL if the update was aborted
+ */
+int ota_delta_handle_chunk(const uint8_t *data, size_t len, uint32_t *next_seq);
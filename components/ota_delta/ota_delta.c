@@ -0,0 +1,355 @@
+#include <string.h>
+#include <stdio.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+
+#include "mbedtls/sha256.h"
+#include "mbedtls/md.h"
+
+#include "ota_delta.h"
+
+
+typedef enum ota_state_t
+{
+    OTA_STATE_IDLE,
+    OTA_STATE_HEADER,
+    OTA_STATE_OP,
+    OTA_STATE_INSERT,
+    OTA_STATE_DONE,
+} ota_state_t;
+
+
+static const char *TAG = "ota_delta";
+
+static const char ota_key[] = CONFIG_OTA_DELTA_KEY;
+
+static ota_state_t state = OTA_STATE_IDLE;
+static uint32_t expected_seq = 0;
+
+/* Header and current op being assembled across chunks */
+static uint8_t hdr[OTA_DELTA_HDR_LEN];
+static size_t hdr_fill;
+static uint8_t op[9];
+static size_t op_fill;
+
+static uint32_t new_size;
+static uint32_t base_size;
+static uint32_t written;
+static uint32_t insert_left;
+
+static const esp_partition_t *running;
+static const esp_partition_t *update;
+static esp_ota_handle_t handle;
+static uint8_t handle_open = 0;
+
+static uint8_t copy_buf[OTA_DELTA_COPY_BUF];
+
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+
+static int partition_sha256(const esp_partition_t *part, uint32_t len, uint8_t *out)
+{
+    mbedtls_sha256_context ctx;
+    uint32_t off = 0;
+    uint32_t n;
+    int ret = ESP_OK;
+
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts_ret(&ctx, 0);
+
+    while (off < len)
+    {
+        n = len - off < sizeof(copy_buf) ? len - off : sizeof(copy_buf);
+
+        ret = esp_partition_read(part, off, copy_buf, n);
+        if (ret != ESP_OK)
+            break;
+
+        mbedtls_sha256_update_ret(&ctx, copy_buf, n);
+        off += n;
+    }
+
+    mbedtls_sha256_finish_ret(&ctx, out);
+    mbedtls_sha256_free(&ctx);
+
+    return ret;
+}
+
+
+/**
+ * @brief Check the header HMAC against the built-in key, in constant time.
+ * 
+ * @return uint8_t 1 if the header was made by a holder of the key
+ */
+static uint8_t ota_header_authentic(void)
+{
+    uint8_t mac[32];
+    uint8_t diff = 0;
+
+    /* Without a key anyone could sign, so refuse everything */
+    if (sizeof(ota_key) <= 1)
+        return 0;
+
+    if (mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
+            (const uint8_t *)ota_key, sizeof(ota_key) - 1,
+            hdr, OTA_DELTA_MAC_OFFSET, mac) != 0)
+        return 0;
+
+    for (int i = 0; i < sizeof(mac); i++)
+        diff |= mac[i] ^ hdr[OTA_DELTA_MAC_OFFSET + i];
+
+    return diff == 0;
+}
+
+
+static int ota_abort(const char *reason)
+{
+    ESP_LOGI(TAG, "update aborted at %u bytes: %s", (unsigned)written, reason);
+
+    if (handle_open)
+        esp_ota_end(handle);
+
+    handle_open = 0;
+    state = OTA_STATE_IDLE;
+
+    return OTA_DELTA_FAIL;
+}
+
+
+static int ota_start(void)
+{
+    uint8_t hash[32];
+
+    if (memcmp(hdr, OTA_DELTA_MAGIC, 4) != 0)
+        return ota_abort("bad magic");
+
+    if (!ota_header_authentic())
+        return ota_abort("header not authenticated");
+
+    new_size = get_le32(&hdr[4]);
+    base_size = get_le32(&hdr[40]);
+
+    running = esp_ota_get_running_partition();
+    update = esp_ota_get_next_update_partition(NULL);
+
+    if (update == NULL)
+        return ota_abort("no update partition");
+
+    if (base_size > running->size || new_size > update->size)
+        return ota_abort("image too large");
+
+    /* Only apply patches made against the image we are running */
+    if (partition_sha256(running, base_size, hash) != ESP_OK ||
+        memcmp(hash, &hdr[44], sizeof(hash)) != 0)
+        return ota_abort("base image mismatch");
+
+    if (esp_ota_begin(update, new_size, &handle) != ESP_OK)
+        return ota_abort("esp_ota_begin failed");
+
+    handle_open = 1;
+    written = 0;
+    op_fill = 0;
+    state = OTA_STATE_OP;
+
+    ESP_LOGI(TAG, "applying patch, %u byte image to %s", (unsigned)new_size, update->label);
+
+    return OTA_DELTA_IN_PROGRESS;
+}
+
+
+static int ota_finish(void)
+{
+    uint8_t hash[32];
+
+    handle_open = 0;
+    state = OTA_STATE_IDLE;
+
+    if (esp_ota_end(handle) != ESP_OK)
+        return ota_abort("esp_ota_end failed");
+
+    /* Hash what actually landed in flash, not what we meant to write */
+    if (partition_sha256(update, new_size, hash) != ESP_OK ||
+        memcmp(hash, &hdr[8], sizeof(hash)) != 0)
+        return ota_abort("image hash mismatch");
+
+    if (esp_ota_set_boot_partition(update) != ESP_OK)
+        return ota_abort("esp_ota_set_boot_partition failed");
+
+    state = OTA_STATE_DONE;
+
+    ESP_LOGI(TAG, "image verified, boots from %s on restart", update->label);
+
+    return OTA_DELTA_DONE;
+}
+
+
+static int ota_copy(uint32_t src, uint32_t len)
+{
+    uint32_t n;
+
+    if (src + len > base_size || src + len < src || written + len > new_size)
+        return ota_abort("copy out of range");
+
+    while (len)
+    {
+        n = len < sizeof(copy_buf) ? len : sizeof(copy_buf);
+
+        if (esp_partition_read(running, src, copy_buf, n) != ESP_OK ||
+            esp_ota_write(handle, copy_buf, n) != ESP_OK)
+            return ota_abort("copy failed");
+
+        src += n;
+        len -= n;
+        written += n;
+    }
+
+    return OTA_DELTA_IN_PROGRESS;
+}
+
+
+static int ota_feed(const uint8_t *data, size_t len)
+{
+    int ret = OTA_DELTA_IN_PROGRESS;
+    size_t n;
+
+    while (len && ret == OTA_DELTA_IN_PROGRESS)
+    {
+        switch (state)
+        {
+        case OTA_STATE_HEADER:
+            n = OTA_DELTA_HDR_LEN - hdr_fill;
+            n = len < n ? len : n;
+            memcpy(&hdr[hdr_fill], data, n);
+            hdr_fill += n;
+
+            if (hdr_fill == OTA_DELTA_HDR_LEN)
+                ret = ota_start();
+            break;
+
+        case OTA_STATE_OP:
+            n = 1;
+            op[op_fill++] = *data;
+
+            if (op[0] == OTA_DELTA_OP_COPY && op_fill == 9)
+            {
+                op_fill = 0;
+                ret = ota_copy(get_le32(&op[1]), get_le32(&op[5]));
+            }
+            else if (op[0] == OTA_DELTA_OP_INSERT && op_fill == 5)
+            {
+                op_fill = 0;
+                insert_left = get_le32(&op[1]);
+
+                if (written + insert_left > new_size || written + insert_left < written)
+                    ret = ota_abort("insert out of range");
+                else
+                    state = OTA_STATE_INSERT;
+            }
+            else if (op[0] != OTA_DELTA_OP_COPY && op[0] != OTA_DELTA_OP_INSERT)
+                ret = ota_abort("bad op");
+            break;
+
+        case OTA_STATE_INSERT:
+            n = len < insert_left ? len : insert_left;
+
+            if (esp_ota_write(handle, data, n) != ESP_OK)
+            {
+                ret = ota_abort("write failed");
+                break;
+            }
+
+            written += n;
+            insert_left -= n;
+
+            if (insert_left == 0)
+                state = OTA_STATE_OP;
+            break;
+
+        default:
+            return OTA_DELTA_IDLE;
+        }
+
+        data += n;
+        len -= n;
+
+        if (ret == OTA_DELTA_IN_PROGRESS && state == OTA_STATE_OP &&
+            op_fill == 0 && written == new_size)
+            ret = ota_finish();
+    }
+
+    return ret;
+}
+
+
+int ota_delta_handle_chunk(const uint8_t *data, size_t len, uint32_t *next_seq)
+{
+    uint32_t seq;
+    size_t n;
+    int ret;
+
+    /* The verified image waits for the restart, nothing may replace it */
+    if (state == OTA_STATE_DONE)
+    {
+        *next_seq = expected_seq;
+        return OTA_DELTA_DONE;
+    }
+
+    if (len < OTA_DELTA_SEQ_LEN)
+    {
+        *next_seq = expected_seq;
+        return state == OTA_STATE_IDLE ? OTA_DELTA_IDLE : OTA_DELTA_IN_PROGRESS;
+    }
+
+    seq = get_le32(data);
+
+    /* Sequence 0 carries the header. A resend of the one in progress is
+     * dropped like any other duplicate, a different one restarts */
+    if (seq == 0 && state != OTA_STATE_IDLE)
+    {
+        n = len - OTA_DELTA_SEQ_LEN < hdr_fill ? len - OTA_DELTA_SEQ_LEN : hdr_fill;
+
+        if (n == 0 || memcmp(data + OTA_DELTA_SEQ_LEN, hdr, n) != 0)
+            ota_abort("restarted by sender");
+    }
+
+    if (seq == 0 && state == OTA_STATE_IDLE)
+    {
+        state = OTA_STATE_HEADER;
+        hdr_fill = 0;
+        written = 0;
+        expected_seq = 0;
+    }
+
+    if (state == OTA_STATE_IDLE)
+    {
+        *next_seq = 0;
+        return OTA_DELTA_IDLE;
+    }
+
+    /* Lost or reordered chunk, drop it and ack what we still need */
+    if (seq != expected_seq)
+    {
+        *next_seq = expected_seq;
+        return OTA_DELTA_IN_PROGRESS;
+    }
+
+    expected_seq++;
+
+    ret = ota_feed(data + OTA_DELTA_SEQ_LEN, len - OTA_DELTA_SEQ_LEN);
+
+    if (ret == OTA_DELTA_FAIL)
+        expected_seq = 0;
+
+    *next_seq = expected_seq;
+
+    return ret;
+}
@@ -1,4 +1,7 @@
 #include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <sys/time.h>
 
 /* For getenv functions */
 #include <stdlib.h>
@@ -6,27 +9,38 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/timers.h"
+#include "freertos/queue.h"
 #include "esp_system.h"
 #include "esp_err.h"
 #include "esp_log.h"
 #include "esp_netif.h"
 #include "esp_event.h"
 #include "esp_wifi.h"
+#include "esp_timer.h"
 #include "nvs.h"
 #include "nvs_flash.h"
 
 #include "lwip/err.h"
 #include "lwip/sys.h"
+#include "lwip/apps/sntp.h"
 
 #include "mqtt_client.h"
+#include "mqttsn.h"
 
 #include "driver/i2c.h"
 
 /* Project components for I2C sensors */
 #include "i2c_helpers.h"
+#include "i2c_bus.h"
 #include "am2301b.h"
 #include "ltr390.h"
 
+#include "dlog.h"
+#include "ota_delta.h"
+
+#include "sample_sched.h"
+
 
 #define WIFI_SSID               CONFIG_WIFI_SSID
 #define WIFI_PASS               CONFIG_WIFI_PASS
@@ -34,6 +48,12 @@
 
 #define MQTT_URI                CONFIG_ESP_MQTT_URI 
 
+#define SNTP_SERVER             CONFIG_SNTP_SERVER
+#define SAMPLE_PERIOD_MS        CONFIG_SAMPLE_PERIOD_MS
+
+/* Wall clock is considered valid once it is past 2020-01-01 */
+#define WALL_CLOCK_MIN_EPOCH    1577836800
+
 #define MQTT_QOS                1
 #define MQTT_RETAIN             0
 #define MQTT_TOPIC_HUM          "home/humidity/office"
@@ -41,21 +61,60 @@
 #define MQTT_TOPIC_ALS          "home/luminosity/office"
 #define MQTT_TOPIC_UVS          "home/uv_intensity/office"
 #define MQTT_MAX_TOPIC_LEN      128
+#define MQTT_MAX_PAYLOAD_LEN    64
+
+#ifdef CONFIG_OTA_DELTA_ENABLE
+#define OTA_TOPIC_PATCH         CONFIG_OTA_TOPIC "/patch"
+#define OTA_TOPIC_STATUS        CONFIG_OTA_TOPIC "/status"
+#define OTA_RESTART_DELAY_MS    2000
+#define OTA_QUEUE_LEN           8
+#define OTA_TASK_PRIORITY       2
+#endif
+
+#ifdef CONFIG_PUBLISH_TRANSPORT_MQTTSN
+#define MQTTSN_GATEWAY_HOST     CONFIG_MQTTSN_GATEWAY_HOST
+#define MQTTSN_GATEWAY_PORT     CONFIG_MQTTSN_GATEWAY_PORT
+#define MQTTSN_CLIENT_ID        CONFIG_MQTTSN_CLIENT_ID
+#define MQTTSN_TOPIC_ID_HUM     CONFIG_MQTTSN_TOPIC_ID_HUM
+#define MQTTSN_TOPIC_ID_TMP     CONFIG_MQTTSN_TOPIC_ID_TMP
+#define MQTTSN_TOPIC_ID_ALS     CONFIG_MQTTSN_TOPIC_ID_ALS
+#define MQTTSN_TOPIC_ID_UVS     CONFIG_MQTTSN_TOPIC_ID_UVS
+#ifdef CONFIG_MQTTSN_QOS_1
+#define MQTTSN_QOS              MQTTSN_QOS_AT_LEAST_1
+#else
+#define MQTTSN_QOS              MQTTSN_QOS_FIRE_FORGET
+#endif
+#endif
 
 #define MQTT_MSG_AVAIL_BIT      0x1
 #define MQTT_BROKER_CON         0x1 << 1
 #define MQTT_BROKER_DIS         0x1 << 2
 
 
+#ifdef CONFIG_PUBLISH_TRANSPORT_MQTT
 /* MQTT client instance */
 static esp_mqtt_client_handle_t client;
+#endif
 
 /* FreeRTOS task handles */
 static TaskHandle_t i2c_task_handle;
 
+#ifdef CONFIG_OTA_DELTA_ENABLE
+/* Patch chunk copied out of an MQTT event, for the OTA task */
+typedef struct ota_chunk_t
+{
+    uint8_t *data;
+    size_t len;
+} ota_chunk_t;
+
+static QueueHandle_t ota_queue;
+#endif
+
 /* FreeRTOS event group */
 static EventGroupHandle_t s_wifi_event_group;
+#ifdef CONFIG_PUBLISH_TRANSPORT_MQTT
 static EventGroupHandle_t s_mqtt_event_group;
+#endif
 
 /* Wifi events */
 #define WIFI_CONNECTED_BIT  BIT0
@@ -89,8 +148,46 @@ typedef struct mqtt_msg_t
 } mqtt_msg_t;
 
 
+/**
+ * @brief Time at which a sample was acquired
+ * 
+ */
+typedef struct sample_ts_t
+{
+    long sec;           // Seconds since epoch, or since boot if not synced
+    int msec;           // Millisecond part
+    uint8_t synced;     // 1 if wall clock came from SNTP
+} sample_ts_t;
+
+
+/**
+ * @brief Where one stream of samples is published
+ * 
+ */
+typedef struct sample_topic_t
+{
+    const char *topic;          // MQTT topic string
+#ifdef CONFIG_PUBLISH_TRANSPORT_MQTTSN
+    uint16_t topic_id;          // MQTT-SN pre-defined topic id
+    mqttsn_topic_t sn;          // MQTT-SN PUBLISH template
+#endif
+} sample_topic_t;
+
+
 static const char *TAG = "esp8266_ambient_monitor";
 
+#ifdef CONFIG_PUBLISH_TRANSPORT_MQTTSN
+static sample_topic_t topic_hum = { .topic = MQTT_TOPIC_HUM, .topic_id = MQTTSN_TOPIC_ID_HUM };
+static sample_topic_t topic_tmp = { .topic = MQTT_TOPIC_TMP, .topic_id = MQTTSN_TOPIC_ID_TMP };
+static sample_topic_t topic_als = { .topic = MQTT_TOPIC_ALS, .topic_id = MQTTSN_TOPIC_ID_ALS };
+static sample_topic_t topic_uvs = { .topic = MQTT_TOPIC_UVS, .topic_id = MQTTSN_TOPIC_ID_UVS };
+#else
+static sample_topic_t topic_hum = { .topic = MQTT_TOPIC_HUM };
+static sample_topic_t topic_tmp = { .topic = MQTT_TOPIC_TMP };
+static sample_topic_t topic_als = { .topic = MQTT_TOPIC_ALS };
+static sample_topic_t topic_uvs = { .topic = MQTT_TOPIC_UVS };
+#endif
+
 QueueHandle_t mqtt_msg_queue = NULL;
 
 /* Wifi retry counter */
@@ -113,13 +210,13 @@ static void wifi_event_handler(
         if (s_retry_num < MAX_RETRY) {
             esp_wifi_connect();
             s_retry_num++;
-            ESP_LOGI(TAG, "retry to connect to the AP");
+            DLOG(DLOG_WIFI_RETRY);
         }
         else
         {
             xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
         }
-        ESP_LOGI(TAG,"connect to the AP fail");
+        DLOG(DLOG_WIFI_CONNECT_FAIL);
     }
     else if (event_id == IP_EVENT_STA_GOT_IP)
     {
@@ -131,15 +228,111 @@ static void wifi_event_handler(
     else
     {
         if (event_base == WIFI_EVENT)
-            ESP_LOGI(TAG, "WIFI_EVENT %d", event_id);
+            DLOG1(DLOG_WIFI_EVENT, event_id);
         else if (event_base == IP_EVENT)
-            ESP_LOGI(TAG, "IP_EVENT %d", event_id);
+            DLOG1(DLOG_IP_EVENT, event_id);
         else
-            ESP_LOGI(TAG, "Unknown event in %s: %d", __func__, event_id);
+            DLOG1(DLOG_UNKNOWN_EVENT, event_id);
+    }
+}
+
+
+#ifdef CONFIG_OTA_DELTA_ENABLE
+static void ota_restart(TimerHandle_t timer)
+{
+    esp_restart();
+}
+
+
+/**
+ * @brief Hand a delta OTA chunk from the broker to the OTA task. Applying
+ *      it hashes whole images and erases flash, which must not hold up the
+ *      MQTT task and every publish queued behind it.
+ * 
+ * @param event MQTT_EVENT_DATA event
+ */
+static void ota_handle_data(esp_mqtt_event_handle_t event)
+{
+    ota_chunk_t chunk;
+
+    if (event->topic_len != strlen(OTA_TOPIC_PATCH) ||
+        strncmp(event->topic, OTA_TOPIC_PATCH, event->topic_len) != 0)
+        return;
+
+    /* Chunks must fit in one MQTT buffer */
+    if (event->data_len != event->total_data_len)
+        return;
+
+    chunk.len = event->data_len;
+    chunk.data = malloc(chunk.len);
+    if (chunk.data == NULL)
+    {
+        DLOG(DLOG_OTA_CHUNK_DROPPED);
+        return;
+    }
+    memcpy(chunk.data, event->data, chunk.len);
+
+    /* Never wait here. A dropped chunk is resent by the sender once the
+     * device acks the sequence number it still needs */
+    if (xQueueSend(ota_queue, &chunk, 0) != pdTRUE)
+    {
+        free(chunk.data);
+        DLOG(DLOG_OTA_CHUNK_DROPPED);
+    }
+}
+
+
+/**
+ * @brief Apply queued delta OTA chunks and report progress on the status
+ *      topic. Restarts into the new image once it is verified.
+ * 
+ */
+static void ota_task(void *pvParameters)
+{
+    TimerHandle_t restart_timer = NULL;
+    ota_chunk_t chunk;
+    char status[32];
+    uint32_t next_seq;
+    uint32_t seq;
+    int ret;
+
+loop:
+
+    xQueueReceive(ota_queue, &chunk, portMAX_DELAY);
+
+    ret = ota_delta_handle_chunk(chunk.data, chunk.len, &next_seq);
+
+    /* Echo the sequence number received, see ota_delta.h */
+    seq = 0;
+    if (chunk.len >= OTA_DELTA_SEQ_LEN)
+        seq = chunk.data[0] | (chunk.data[1] << 8) | (chunk.data[2] << 16) |
+            ((uint32_t)chunk.data[3] << 24);
+    free(chunk.data);
+
+    if (ret == OTA_DELTA_DONE)
+        snprintf(status, sizeof(status), "done");
+    else if (ret == OTA_DELTA_FAIL)
+        snprintf(status, sizeof(status), "error");
+    else
+        snprintf(status, sizeof(status), "ack %u %u", (unsigned)next_seq, (unsigned)seq);
+
+    esp_mqtt_client_publish(client, OTA_TOPIC_STATUS, status, 0, MQTT_QOS, 0);
+
+    /* Restart from a timer so the status message gets out first. Late
+     * chunks keep returning done, the timer is only started once */
+    if (ret == OTA_DELTA_DONE && restart_timer == NULL)
+    {
+        restart_timer = xTimerCreate("ota restart",
+            OTA_RESTART_DELAY_MS / portTICK_PERIOD_MS, pdFALSE, NULL, ota_restart);
+        xTimerStart(restart_timer, 0);
     }
+
+    goto loop;
 }
+#endif
 
 
+#ifdef CONFIG_PUBLISH_TRANSPORT_MQTT
 static void mqtt_event_handler(
     void* arg,
     esp_event_base_t event_base,
@@ -156,31 +349,38 @@ static void mqtt_event_handler(
     case MQTT_EVENT_CONNECTED:
         xTaskNotify(i2c_task_handle, 0, eNoAction);
 
-        ESP_LOGI(TAG, "MQTT_EVENT_CONNECTED");
+#ifdef CONFIG_OTA_DELTA_ENABLE
+        esp_mqtt_client_subscribe(client, OTA_TOPIC_PATCH, MQTT_QOS);
+#endif
+
+        DLOG(DLOG_MQTT_CONNECTED);
         break;
     case MQTT_EVENT_DISCONNECTED:
-        ESP_LOGI(TAG, "MQTT_EVENT_DISCONNECTED");
+        DLOG(DLOG_MQTT_DISCONNECTED);
         break;
     case MQTT_EVENT_SUBSCRIBED:
-        ESP_LOGI(TAG, "MQTT_EVENT_SUBSCRIBED");
+        DLOG(DLOG_MQTT_SUBSCRIBED);
         break;
     case MQTT_EVENT_UNSUBSCRIBED:
-        ESP_LOGI(TAG, "MQTT_EVENT_UNSUBSCRIBED");
+        DLOG(DLOG_MQTT_UNSUBSCRIBED);
         break;
     case MQTT_EVENT_PUBLISHED:
         // ESP_LOGI(TAG, "MQTT_EVENT_PUBLISHED");
         break;
     case MQTT_EVENT_DATA:
-        ESP_LOGI(TAG, "MQTT_EVENT_DATA");
+        DLOG(DLOG_MQTT_DATA);
+#ifdef CONFIG_OTA_DELTA_ENABLE
+        ota_handle_data(event);
+#endif
         break;
     case MQTT_EVENT_BEFORE_CONNECT:
-        ESP_LOGI(TAG, "MQTT_EVENT_BEFORE_CONNECT");
+        DLOG(DLOG_MQTT_BEFORE_CONNECT);
         break;
     case MQTT_EVENT_ERROR:
-        ESP_LOGI(TAG, "MQTT_EVENT_ERROR");
+        DLOG(DLOG_MQTT_ERROR);
         break;
     default:
-        ESP_LOGI(TAG, "Other event id:%d", event->event_id);
+        DLOG1(DLOG_MQTT_OTHER, event->event_id);
         break;
     }
 }
@@ -199,62 +399,176 @@ static void mqtt_init_client()
 
     esp_mqtt_client_start(client);
 }
+#endif
 
 
-static void i2c_sensors_task(void *pvParameters)
+#ifdef CONFIG_PUBLISH_TRANSPORT_MQTTSN
+static void mqttsn_init_client()
 {
-    /* init */
+    mqttsn_topic_init(&topic_hum.sn, topic_hum.topic_id, MQTTSN_QOS);
+    mqttsn_topic_init(&topic_tmp.sn, topic_tmp.topic_id, MQTTSN_QOS);
+    mqttsn_topic_init(&topic_als.sn, topic_als.topic_id, MQTTSN_QOS);
+    mqttsn_topic_init(&topic_uvs.sn, topic_uvs.topic_id, MQTTSN_QOS);
 
-    int i2c_master_port = I2C_MASTER_PORT;
+    if (mqttsn_init(MQTTSN_GATEWAY_HOST, MQTTSN_GATEWAY_PORT, MQTTSN_CLIENT_ID, MQTTSN_QOS) != MQTTSN_OK)
+        ESP_LOGI(TAG, "MQTT-SN gateway not reachable, retrying on publish");
+}
+#endif
 
-    i2c_config_t config = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = I2C_MASTER_SDA_IO,
-        .scl_io_num = I2C_MASTER_SCL_IO,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .clk_stretch_tick = 300,
-    };
 
-    ESP_ERROR_CHECK(i2c_driver_install(i2c_master_port, config.mode));
-    ESP_ERROR_CHECK(i2c_param_config(i2c_master_port, &config));
+/**
+ * @brief Publish a sample payload with the configured transport.
+ * 
+ * @param topic     Destination of the sample
+ * @param payload   Payload string
+ * @param retain    Retain flag for broker (MQTT over TCP only)
+ */
+static void publish_sample(sample_topic_t *topic, const char *payload, int retain)
+{
+#ifdef CONFIG_PUBLISH_TRANSPORT_MQTTSN
+    if (mqttsn_publish(&topic->sn, payload, strlen(payload)) != MQTTSN_OK)
+        DLOG1(DLOG_PUBLISH_FAIL, topic->topic_id);
+#else
+    esp_mqtt_client_publish(client, topic->topic, payload, 0, MQTT_QOS, retain);
+#endif
+}
 
-    am2301b_init();
 
-    char hum_payload[25];
-    char tmp_payload[25];
-    char als_payload[25];
-    char uvs_payload[25];
+static void sntp_init_time(void)
+{
+    sntp_setoperatingmode(SNTP_OPMODE_POLL);
+    sntp_setservername(0, SNTP_SERVER);
+    sntp_init();
+}
+
+
+/**
+ * @brief Stamp a sample with the current time. Uses the SNTP-backed wall
+ * clock when it has been set, otherwise falls back to the monotonic time
+ * since boot.
+ * 
+ * @param ts Where to store the timestamp
+ */
+static void sample_timestamp(sample_ts_t *ts)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
 
-    uint8_t ret;
+    if (tv.tv_sec >= WALL_CLOCK_MIN_EPOCH)
+    {
+        ts->sec = tv.tv_sec;
+        ts->msec = tv.tv_usec / 1000;
+        ts->synced = 1;
+    }
+    else
+    {
+        int64_t uptime_us = esp_timer_get_time();
+
+        ts->sec = (long)(uptime_us / 1000000);
+        ts->msec = (int)((uptime_us / 1000) % 1000);
+        ts->synced = 0;
+    }
+}
+
+
+/**
+ * @brief Write the MQTT payload for a sample value.
+ * 
+ * @param buf   Payload buffer, MQTT_MAX_PAYLOAD_LEN bytes
+ * @param value Sample value string
+ * @param ts    Acquisition time of the sample
+ */
+static void sample_payload(char *buf, const char *value, const sample_ts_t *ts)
+{
+#ifdef CONFIG_MQTT_PAYLOAD_TIMESTAMP
+    snprintf(buf, MQTT_MAX_PAYLOAD_LEN, "{\"value\":%s,\"%s\":%ld.%03d}",
+        value, ts->synced ? "ts" : "uptime", ts->sec, ts->msec);
+#else
+    snprintf(buf, MQTT_MAX_PAYLOAD_LEN, "%s", value);
+#endif
+}
+
+
+static void i2c_sensors_task(void *pvParameters)
+{
+    /* init */
+
+    i2c_bus_init();
+
+    am2301b_init();
+
+    char hum_value[25];
+    char tmp_value[25];
+    char als_value[25];
+    char uvs_value[25];
+
+    char hum_payload[MQTT_MAX_PAYLOAD_LEN];
+    char tmp_payload[MQTT_MAX_PAYLOAD_LEN];
+    char als_payload[MQTT_MAX_PAYLOAD_LEN];
+    char uvs_payload[MQTT_MAX_PAYLOAD_LEN];
+
+    sample_ts_t ts, am2301b_ts;
+    i2c_bus_stats_t bus_stats;
+    TickType_t am2301b_start;
+    uint8_t ret, am2301b_ret;
+
+    /* Reference point for the fixed-rate sample period */
+    TickType_t sample_wake = xTaskGetTickCount();
+    sample_sched_t sched;
+    sample_sched_init(&sched, sample_wake, SAMPLE_PERIOD_MS, portTICK_PERIOD_MS);
     
     // mqtt_msg_t msg_hum, msg_tmp, msg_als, msg_uvs, *ptr_msg; 
 
 loop:
 
-    /* AM2301B temperature and humidity sensor */
-    ret = am2301b_trigger_measurement(hum_payload, tmp_payload);
+    /* Start the AM2301B conversion first, the LTR390 uses the bus while
+     * it runs */
+    sample_timestamp(&am2301b_ts);
+    am2301b_ret = am2301b_start_measurement();
+    am2301b_start = xTaskGetTickCount();
+
+    /* LTR390 ambient light sensor, stamped when the conversion starts */
+    sample_timestamp(&ts);
+    ret = ltr390_trigger_measurement(als_value, uvs_value);
 
     if (ret == I2C_OK)
     {
-        // ESP_LOGI(TAG, "HUM: %s, TMP: %s", hum_payload, tmp_payload);
-        esp_mqtt_client_publish(client, MQTT_TOPIC_HUM, hum_payload, 0, MQTT_QOS, MQTT_RETAIN);
-        esp_mqtt_client_publish(client, MQTT_TOPIC_HUM, tmp_payload, 0, MQTT_QOS, MQTT_RETAIN);
+        sample_payload(als_payload, als_value, &ts);
+        sample_payload(uvs_payload, uvs_value, &ts);
+
+        // ESP_LOGI(TAG, "LUM: %s, UVI: %s", als_payload, uvs_payload);
+        publish_sample(&topic_als, als_payload, 0);
+        publish_sample(&topic_uvs, uvs_payload, 0);
     }
-    else ESP_LOGI(TAG, "AM2301B trouble");
+    else DLOG(DLOG_LTR390_TROUBLE);
 
-    /* LTR390 ambient light sensor */
-    ret = ltr390_trigger_measurement(als_payload, uvs_payload);
+    /* AM2301B temperature and humidity sensor. The conversion is normally
+     * done by now, this only waits if the LTR390 failed early */
+    if (am2301b_ret == I2C_OK)
+    {
+        vTaskDelayUntil(&am2301b_start, AM2301B_MEAS_TIME_MS / portTICK_PERIOD_MS);
+        am2301b_ret = am2301b_read_measurement(hum_value, tmp_value);
+    }
 
-    if (ret == I2C_OK)
+    if (am2301b_ret == I2C_OK)
     {
-        // ESP_LOGI(TAG, "LUM: %s, UVI: %s", als_payload, uvs_payload);
-        esp_mqtt_client_publish(client, MQTT_TOPIC_ALS, als_payload, 0, MQTT_QOS, 0);
-        esp_mqtt_client_publish(client, MQTT_TOPIC_UVS, uvs_payload, 0, MQTT_QOS, 0);
+        sample_payload(hum_payload, hum_value, &am2301b_ts);
+        sample_payload(tmp_payload, tmp_value, &am2301b_ts);
+
+        // ESP_LOGI(TAG, "HUM: %s, TMP: %s", hum_payload, tmp_payload);
+        publish_sample(&topic_hum, hum_payload, MQTT_RETAIN);
+        publish_sample(&topic_tmp, tmp_payload, MQTT_RETAIN);
     }
-    else ESP_LOGI(TAG, "ltr390 trouble");
+    else DLOG(DLOG_AM2301B_TROUBLE);
 
-    vTaskDelay(20000 / portTICK_PERIOD_MS);
+    i2c_bus_get_stats(&bus_stats);
+    DLOG3(DLOG_I2C_BUS_STATS, i2c_bus_utilization(&bus_stats),
+        bus_stats.transactions, bus_stats.errors);
+
+    /* Sleep until the next period boundary, so time spent sampling and
+     * publishing does not accumulate as drift */
+    vTaskDelayUntil(&sample_wake, sample_sched_next(&sched, xTaskGetTickCount()));
 
     goto loop;
 
@@ -323,17 +637,38 @@ static void wifi_init_sta(void)
 
 void app_main()
 {
+    dlog_init();
+
     ESP_ERROR_CHECK(nvs_flash_init());
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
 
     wifi_init_sta();
+    sntp_init_time();
+
+#ifdef CONFIG_OTA_DELTA_ENABLE
+    /* Below the sample task, so an update never delays a sample */
+    ota_queue = xQueueCreate(OTA_QUEUE_LEN, sizeof(ota_chunk_t));
+    xTaskCreate(
+        ota_task,
+        "ota task",
+        3072,
+        NULL,
+        OTA_TASK_PRIORITY,
+        NULL
+    );
+#endif
+
+#ifdef CONFIG_PUBLISH_TRANSPORT_MQTTSN
+    mqttsn_init_client();
+#else
     mqtt_init_client();
+#endif
 
     xTaskCreate(
         i2c_sensors_task,
         "i2c sensors task",
-        2048,
+        3072,
         NULL,
         5,
         &i2c_task_handle
@@ -0,0 +1,31 @@
+#include <stdint.h>
+
+#include "sample_sched.h"
+
+
+void sample_sched_init(sample_sched_t *sched, uint32_t now, uint32_t period_ms, uint32_t tick_ms)
+{
+    sched->start = now;
+    sched->target = now;
+    sched->period_ms = period_ms;
+    sched->tick_ms = tick_ms;
+    sched->n = 0;
+}
+
+
+uint32_t sample_sched_next(sample_sched_t *sched, uint32_t now)
+{
+    uint32_t prev = sched->target;
+    uint32_t target;
+
+    /* Tick arithmetic is modulo 2^32, so this also holds across wrap */
+    do
+    {
+        sched->n++;
+        target = sched->start + (uint32_t)(sched->n * sched->period_ms / sched->tick_ms);
+    } while ((int32_t)(target - now) <= 0);
+
+    sched->target = target;
+
+    return target - prev;
+}
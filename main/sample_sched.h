@@ -0,0 +1,42 @@
+/**
+ * @brief Fixed-rate sample schedule. Wake-ups are computed from the start
+ *      tick and the number of periods elapsed, in milliseconds, so neither
+ *      the time spent sampling nor a period that is not a whole number of
+ *      ticks builds up into drift.
+ * 
+ */
+typedef struct sample_sched_t
+{
+    uint32_t start;         // Tick count the schedule is anchored to
+    uint32_t target;        // Wake-up tick last returned, start at first
+    uint32_t period_ms;     // Sample period
+    uint32_t tick_ms;       // Length of a tick, portTICK_PERIOD_MS
+    uint64_t n;             // Periods elapsed since start
+} sample_sched_t;
+
+
+/**
+ * @brief Anchor a schedule at the current tick count.
+ * 
+ * @param sched     Schedule to set up
+ * @param now       Current tick count
+ * @param period_ms Sample period, at least one tick
+ * @param tick_ms   Length of a tick in milliseconds
+ */
+void sample_sched_init(sample_sched_t *sched, uint32_t now, uint32_t period_ms, uint32_t tick_ms);
+
+
+/**
+ * @brief Advance to the next period boundary after now. Boundaries already
+ *      in the past are skipped rather than run back to back, so an overrun
+ *      costs samples instead of shifting the schedule.
+ * 
+ *      The result is the increment for vTaskDelayUntil() from the previous
+ *      wake-up, so the sleep is absolute and preemption between reading
+ *      the tick count and sleeping does not move it.
+ * 
+ * @param sched Schedule from sample_sched_init()
+ * @param now   Current tick count
+ * @return uint32_t Ticks from the previous wake-up target to the next
+ */
+uint32_t sample_sched_next(sample_sched_t *sched, uint32_t now);
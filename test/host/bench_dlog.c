@@ -0,0 +1,76 @@
+/* Per-call cost of DLOG() against formatting the same message the way
+ * ESP_LOGI does. On the device ESP_LOGI also waits for the UART once its
+ * FIFO is full, that time is computed from the line length. */
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "freertos/FreeRTOS.h"
+#include "dlog.h"
+
+
+#define CALLS                   1000000
+#define UART_FIFO_LEN           128
+
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+int main(void)
+{
+    FILE *null = fopen("/dev/null", "w");
+    int null_fd = open("/dev/null", O_WRONLY);
+    int saved = dup(1);
+    int64_t t0, dlog_ns = 0, flush_ns = 0, logi_ns;
+    int line_len;
+    char line[160];
+
+    /* DLOG(): fill the ring, then drain it outside the timed part */
+    for (int i = 0; i < CALLS; i += DLOG_RING_SIZE)
+    {
+        t0 = now_ns();
+        for (int j = 0; j < DLOG_RING_SIZE; j++)
+            DLOG2(DLOG_LTR390_I2C_ERR, -1, j);
+        dlog_ns += now_ns() - t0;
+
+        fflush(stdout);
+        dup2(null_fd, 1);
+        t0 = now_ns();
+        dlog_flush();
+        fflush(stdout);
+        flush_ns += now_ns() - t0;
+        dup2(saved, 1);
+    }
+
+    /* ESP_LOGI: format with the tag and timestamp prefix and write out */
+    t0 = now_ns();
+    for (int i = 0; i < CALLS; i++)
+    {
+        fprintf(null, "I (%u) %s: error in %s: %d. Check sensor connection.\n",
+            (unsigned)i, "ltr390 i2c sensor", "ltr390_trigger_measurement", -1);
+    }
+    logi_ns = now_ns() - t0;
+
+    line_len = snprintf(line, sizeof(line), "I (%u) %s: error in %s: %d. Check sensor connection.\n",
+        123456u, "ltr390 i2c sensor", "ltr390_trigger_measurement", -1);
+
+    printf("per call, host CPU (%d calls):\n", CALLS);
+    printf("  DLOG2()                   %6.1f ns\n", (double)dlog_ns / CALLS);
+    printf("  ESP_LOGI-style format     %6.1f ns\n", (double)logi_ns / CALLS);
+    printf("  deferred print (log task) %6.1f ns per record\n", (double)flush_ns / CALLS);
+    printf("UART time for the %d byte ESP_LOGI line, paid by the caller once the %d byte FIFO is full:\n",
+        line_len, UART_FIFO_LEN);
+    printf("  74880 baud                %6.2f ms\n", line_len * 10 * 1000.0 / 74880);
+    printf("  115200 baud               %6.2f ms\n", line_len * 10 * 1000.0 / 115200);
+
+    fclose(null);
+    close(null_fd);
+    return 0;
+}
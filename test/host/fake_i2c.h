@@ -0,0 +1,15 @@
+#define FAKE_I2C_CLK_HZ         100000
+
+
+typedef struct fake_i2c_stats_t
+{
+    uint32_t transactions;      // Transactions run
+    uint32_t bytes;             // Bytes moved
+    int64_t busy_us;            // Virtual time the bus was busy
+    size_t last_bytes;          // Bytes in the last transaction
+    TickType_t last_timeout;    // Timeout passed with the last transaction
+    uint8_t read_fill;          // Value returned for every byte read
+} fake_i2c_stats_t;
+
+
+extern fake_i2c_stats_t fake_i2c;
@@ -0,0 +1,63 @@
+/* mbedtls SHA-256 and HMAC for the host tests, on top of OpenSSL */
+#include <stddef.h>
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+#include "mbedtls/sha256.h"
+#include "mbedtls/md.h"
+
+
+struct mbedtls_md_info_t
+{
+    int unused;
+};
+
+
+void mbedtls_sha256_init(mbedtls_sha256_context *ctx)
+{
+    ctx->md = EVP_MD_CTX_new();
+}
+
+
+void mbedtls_sha256_free(mbedtls_sha256_context *ctx)
+{
+    EVP_MD_CTX_free(ctx->md);
+    ctx->md = NULL;
+}
+
+
+int mbedtls_sha256_starts_ret(mbedtls_sha256_context *ctx, int is224)
+{
+    return EVP_DigestInit_ex(ctx->md, is224 ? EVP_sha224() : EVP_sha256(), NULL) == 1 ? 0 : -1;
+}
+
+
+int mbedtls_sha256_update_ret(mbedtls_sha256_context *ctx, const unsigned char *input, size_t len)
+{
+    return EVP_DigestUpdate(ctx->md, input, len) == 1 ? 0 : -1;
+}
+
+
+int mbedtls_sha256_finish_ret(mbedtls_sha256_context *ctx, unsigned char output[32])
+{
+    return EVP_DigestFinal_ex(ctx->md, output, NULL) == 1 ? 0 : -1;
+}
+
+
+const mbedtls_md_info_t *mbedtls_md_info_from_type(mbedtls_md_type_t type)
+{
+    static const mbedtls_md_info_t sha256;
+
+    return type == MBEDTLS_MD_SHA256 ? &sha256 : NULL;
+}
+
+
+int mbedtls_md_hmac(const mbedtls_md_info_t *md_info, const unsigned char *key, size_t keylen,
+    const unsigned char *input, size_t ilen, unsigned char *output)
+{
+    if (md_info == NULL)
+        return -1;
+
+    return HMAC(EVP_sha256(), key, keylen, input, ilen, output, NULL) ? 0 : -1;
+}
@@ -0,0 +1,18 @@
+#include <netdb.h>
+
+
+/* Number of upcoming lookups to fail, as when DNS is not up yet */
+int host_getaddrinfo_fail = 0;
+
+
+int host_getaddrinfo(const char *node, const char *service,
+    const struct addrinfo *hints, struct addrinfo **res)
+{
+    if (host_getaddrinfo_fail > 0)
+    {
+        host_getaddrinfo_fail--;
+        return EAI_AGAIN;
+    }
+
+    return getaddrinfo(node, service, hints, res);
+}
@@ -0,0 +1,83 @@
+/* OTA and partition API on memory, see host_ota.h */
+#include <string.h>
+
+#include "host_ota.h"
+
+
+host_ota_t host_ota = { .boot = -1 };
+
+static const esp_partition_t parts[2] = {
+    { .address = 0x10000, .size = HOST_OTA_PART_SIZE, .label = "ota_0" },
+    { .address = 0x110000, .size = HOST_OTA_PART_SIZE, .label = "ota_1" },
+};
+
+
+static int part_index(const esp_partition_t *part)
+{
+    return part == &parts[1];
+}
+
+
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t offset, void *dst, size_t size)
+{
+    if (offset + size > part->size)
+        return ESP_FAIL;
+
+    memcpy(dst, &host_ota.flash[part_index(part)][offset], size);
+
+    return ESP_OK;
+}
+
+
+const esp_partition_t *esp_ota_get_running_partition(void)
+{
+    return &parts[host_ota.running];
+}
+
+
+const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *start)
+{
+    return &parts[!host_ota.running];
+}
+
+
+esp_err_t esp_ota_begin(const esp_partition_t *part, size_t image_size, esp_ota_handle_t *handle)
+{
+    if (part_index(part) == host_ota.running || image_size > part->size)
+        return ESP_FAIL;
+
+    memset(host_ota.flash[part_index(part)], 0xff, HOST_OTA_PART_SIZE);
+    host_ota.begins++;
+    host_ota.write_off = 0;
+    *handle = host_ota.begins;
+
+    return ESP_OK;
+}
+
+
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
+{
+    if (handle != host_ota.begins || host_ota.write_off + size > HOST_OTA_PART_SIZE)
+        return ESP_FAIL;
+
+    memcpy(&host_ota.flash[!host_ota.running][host_ota.write_off], data, size);
+    host_ota.write_off += size;
+
+    return ESP_OK;
+}
+
+
+esp_err_t esp_ota_end(esp_ota_handle_t handle)
+{
+    host_ota.ends++;
+
+    return handle == host_ota.begins ? ESP_OK : ESP_FAIL;
+}
+
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *part)
+{
+    host_ota.boot = part_index(part);
+
+    return ESP_OK;
+}
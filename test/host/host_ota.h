@@ -0,0 +1,18 @@
+/* Two OTA app partitions in memory, with counters for the tests */
+#include "esp_ota_ops.h"
+
+#define HOST_OTA_PART_SIZE      (128 * 1024)
+
+
+typedef struct host_ota_t
+{
+    uint8_t flash[2][HOST_OTA_PART_SIZE];
+    int running;                // Index of the running partition
+    int boot;                   // Index set by esp_ota_set_boot_partition, -1 if unset
+    int begins;                 // esp_ota_begin calls, each erases the partition
+    int ends;                   // esp_ota_end calls
+    uint32_t write_off;         // Next esp_ota_write offset
+} host_ota_t;
+
+
+extern host_ota_t host_ota;
@@ -0,0 +1,73 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+
+
+int64_t host_time_us = 0;
+
+
+void host_advance_us(int64_t us)
+{
+    host_time_us += us;
+}
+
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(host_time_us / (portTICK_PERIOD_MS * 1000));
+}
+
+
+void vTaskDelay(TickType_t ticks)
+{
+    /* Wake on the tick boundary, like the real scheduler */
+    int64_t tick_us = portTICK_PERIOD_MS * 1000;
+
+    host_time_us = (host_time_us / tick_us + ticks) * tick_us;
+}
+
+
+void vTaskDelayUntil(TickType_t *prev_wake, TickType_t increment)
+{
+    int64_t tick_us = portTICK_PERIOD_MS * 1000;
+
+    *prev_wake += increment;
+
+    /* Returns at once if the wake-up time has already passed */
+    if ((int32_t)(*prev_wake - xTaskGetTickCount()) > 0)
+        host_time_us = (int64_t)*prev_wake * tick_us;
+}
+
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack,
+    void *param, int prio, TaskHandle_t *handle)
+{
+    return pdPASS;
+}
+
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    static int mutex;
+
+    return &mutex;
+}
+
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    return pdTRUE;
+}
+
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    return pdTRUE;
+}
+
+
+int64_t esp_timer_get_time(void)
+{
+    return host_time_us;
+}
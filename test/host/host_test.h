@@ -0,0 +1,19 @@
+/* Minimal assertion helpers for the host tests */
+#include <stdio.h>
+#include <stdlib.h>
+
+static int host_test_failures = 0;
+
+#define CHECK(cond)                                                     \
+do {                                                                    \
+    if (!(cond))                                                        \
+    {                                                                   \
+        fprintf(stderr, "%s:%d: CHECK failed: %s\n",                    \
+            __FILE__, __LINE__, #cond);                                 \
+        host_test_failures++;                                           \
+    }                                                                   \
+} while (0)
+
+#define HOST_TEST_RESULT(name)                                          \
+    (printf("%s: %s\n", name, host_test_failures ? "FAIL" : "ok"),      \
+    host_test_failures ? 1 : 0)
@@ -0,0 +1,122 @@
+"""Stand-ins for an MQTT-SN gateway (UDP) and an MQTT broker (TCP).
+
+Both answer just enough of their protocol for the publish path and record
+what they received, so tests can check the packets on the wire.
+"""
+
+import socket
+import struct
+import threading
+
+CONNECT = 0x04
+CONNACK = 0x05
+PUBLISH = 0x0c
+PUBACK = 0x0d
+PINGREQ = 0x16
+PINGRESP = 0x17
+
+
+class Gateway(threading.Thread):
+    """MQTT-SN gateway on 127.0.0.1, ephemeral port.
+
+    drop_publishes: number of QoS 1 PUBLISHes to ignore (no PUBACK)
+    reject_publishes: number of QoS 1 PUBLISHes to answer with rc 0x02
+    runt_pings: send a 1-byte datagram ahead of the PINGRESP
+    """
+
+    def __init__(self, drop_publishes=0, reject_publishes=0, runt_pings=False):
+        super().__init__(daemon=True)
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.bind(('127.0.0.1', 0))
+        self.sock.settimeout(0.2)
+        self.port = self.sock.getsockname()[1]
+        self.drop_publishes = drop_publishes
+        self.reject_publishes = reject_publishes
+        self.runt_pings = runt_pings
+        self.packets = []
+        self.rx_bytes = 0
+        self.tx_bytes = 0
+        self.running = True
+
+    def reply(self, data, addr):
+        self.tx_bytes += len(data)
+        self.sock.sendto(data, addr)
+
+    def run(self):
+        while self.running:
+            try:
+                data, addr = self.sock.recvfrom(512)
+            except socket.timeout:
+                continue
+            self.rx_bytes += len(data)
+            self.packets.append(data)
+            kind = data[1]
+
+            if kind == CONNECT:
+                self.reply(bytes([3, CONNACK, 0]), addr)
+            elif kind == PINGREQ:
+                if self.runt_pings:
+                    self.reply(bytes([PINGRESP]), addr)
+                self.reply(bytes([2, PINGRESP]), addr)
+            elif kind == PUBLISH and (data[2] >> 5) & 3 == 1:
+                if self.drop_publishes:
+                    self.drop_publishes -= 1
+                    continue
+                rc = 0
+                if self.reject_publishes:
+                    self.reject_publishes -= 1
+                    rc = 2
+                self.reply(bytes([7, PUBACK]) + data[3:7] + bytes([rc]), addr)
+
+    def stop(self):
+        self.running = False
+        self.join()
+        self.sock.close()
+
+    def types(self):
+        return [p[1] for p in self.packets]
+
+
+class Broker(threading.Thread):
+    """MQTT 3.1.1 broker on 127.0.0.1: CONNACK every CONNECT and PUBACK
+    every QoS 1 PUBLISH."""
+
+    def __init__(self):
+        super().__init__(daemon=True)
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.sock.bind(('127.0.0.1', 0))
+        self.sock.listen(8)
+        self.sock.settimeout(0.2)
+        self.port = self.sock.getsockname()[1]
+        self.running = True
+
+    def serve(self, conn):
+        conn.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        buf = b''
+        while True:
+            data = conn.recv(512)
+            if not data:
+                break
+            buf += data
+            while len(buf) >= 2 and len(buf) >= 2 + buf[1]:
+                pkt, buf = buf[:2 + buf[1]], buf[2 + buf[1]:]
+                if pkt[0] >> 4 == 1:
+                    conn.sendall(b'\x20\x02\x00\x00')
+                elif pkt[0] >> 4 == 3:
+                    topic_len, = struct.unpack_from('>H', pkt, 2)
+                    conn.sendall(b'\x40\x02' + pkt[4 + topic_len:6 + topic_len])
+        conn.close()
+
+    def run(self):
+        while self.running:
+            try:
+                conn, _ = self.sock.accept()
+            except socket.timeout:
+                continue
+            self.serve(conn)
+
+    def stop(self):
+        self.running = False
+        self.join()
+        self.sock.close()
@@ -0,0 +1,42 @@
+/* Host stand-in for the ESP8266 I2C master driver, see fake_i2c.c */
+#include <stdint.h>
+#include <stddef.h>
+
+#define ESP_OK                  0
+#define ESP_FAIL                -1
+#define ESP_ERR_TIMEOUT         0x107
+
+#define I2C_MASTER_WRITE        0
+#define I2C_MASTER_READ         1
+
+#define I2C_MODE_MASTER         0
+#define GPIO_PULLUP_DISABLE     0
+#define GPIO_PULLUP_ENABLE      1
+
+#define ESP_ERROR_CHECK(x)      ((void)(x))
+
+typedef int esp_err_t;
+typedef struct fake_i2c_cmd_t *i2c_cmd_handle_t;
+
+typedef struct i2c_config_t
+{
+    int mode;
+    int sda_io_num;
+    int scl_io_num;
+    int sda_pullup_en;
+    int scl_pullup_en;
+    uint32_t clk_stretch_tick;
+} i2c_config_t;
+
+esp_err_t i2c_driver_install(int port, int mode);
+esp_err_t i2c_param_config(int port, const i2c_config_t *config);
+
+i2c_cmd_handle_t i2c_cmd_link_create(void);
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd);
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd);
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd);
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd, uint8_t data, int ack_en);
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd, uint8_t *data, size_t len, int ack_en);
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t cmd, uint8_t *data, int ack);
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd, uint8_t *data, size_t len, int ack);
+esp_err_t i2c_master_cmd_begin(int port, i2c_cmd_handle_t cmd, TickType_t ticks_to_wait);
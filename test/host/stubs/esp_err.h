@@ -0,0 +1,6 @@
+#pragma once
+
+#define ESP_OK                  0
+#define ESP_FAIL                -1
+
+typedef int esp_err_t;
@@ -0,0 +1,33 @@
+/* Host stand-in for the FreeRTOS bits the components use. Time is virtual,
+ * see host_rtos.c. */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdTRUE                  1
+#define pdFALSE                 0
+#define pdPASS                  pdTRUE
+#define portMAX_DELAY           0xffffffffu
+#define portTICK_PERIOD_MS      10
+#define portTICK_RATE_MS        portTICK_PERIOD_MS
+
+/* Single threaded on the host */
+#define portENTER_CRITICAL()
+#define portEXIT_CRITICAL()
+
+/* Virtual time in microseconds, advanced by the test or by vTaskDelay() */
+extern int64_t host_time_us;
+
+void host_advance_us(int64_t us);
+TickType_t xTaskGetTickCount(void);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *prev_wake, TickType_t increment);
+
+/* Tasks are never started on the host, tests call their work directly */
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack,
+    void *param, int prio, TaskHandle_t *handle);
@@ -0,0 +1,9 @@
+#include <netdb.h>
+
+/* Lets a test make name resolution fail, see host_netdb.c */
+#define getaddrinfo host_getaddrinfo
+
+int host_getaddrinfo(const char *node, const char *service,
+    const struct addrinfo *hints, struct addrinfo **res);
+
+extern int host_getaddrinfo_fail;
@@ -0,0 +1,39 @@
+/* dbl2str() output must be a valid JSON number, including below zero */
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "driver/i2c.h"
+#include "i2c_helpers.h"
+#include "host_test.h"
+
+
+/* Not exercised here, i2c_helpers.c only needs it to link */
+int i2c_bus_exec(i2c_cmd_handle_t cmd, size_t xfer_bytes)
+{
+    return ESP_OK;
+}
+
+
+static void check(double d, const char *expected)
+{
+    char buf[MAX_RETURN_BUF_SIZE];
+
+    dbl2str(d, buf);
+    if (strcmp(buf, expected) != 0)
+        fprintf(stderr, "  dbl2str(%f) = \"%s\", expected \"%s\"\n", d, buf, expected);
+    CHECK(strcmp(buf, expected) == 0);
+}
+
+
+int main(void)
+{
+    check(0.0, "0.000000");
+    check(23.5, "23.500000");
+    check(-5.3, "-5.300000");
+    check(-0.5, "-0.500000");
+    check(-40.125, "-40.125000");
+    check(99.9999999, "100.000000");
+    check(-12.0000004, "-12.000000");
+
+    return HOST_TEST_RESULT("test_dbl2str");
+}
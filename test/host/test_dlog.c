@@ -0,0 +1,184 @@
+/* Deferred log ring: ordering, rate limiting by count, overflow. Raw
+ * records printed by dlog_flush() are captured and parsed back. */
+#include <string.h>
+#include <unistd.h>
+
+#include "freertos/FreeRTOS.h"
+#include "dlog.h"
+#include "host_test.h"
+
+
+#define MAX_LINES               64
+
+
+typedef struct line_t
+{
+    unsigned tick, id, suppressed;
+    int args[3];
+} line_t;
+
+
+static line_t lines[MAX_LINES];
+static int n_lines;
+
+
+/* Run dlog_flush() with stdout going to a file and parse what it printed */
+static void flush_capture(void)
+{
+    FILE *tmp = tmpfile();
+    int saved = dup(1);
+    char buf[128];
+    unsigned a0, a1, a2;
+
+    fflush(stdout);
+    dup2(fileno(tmp), 1);
+    dlog_flush();
+    fflush(stdout);
+    dup2(saved, 1);
+    close(saved);
+
+    rewind(tmp);
+    n_lines = 0;
+    while (fgets(buf, sizeof(buf), tmp) && n_lines < MAX_LINES)
+    {
+        line_t *l = &lines[n_lines];
+
+        if (sscanf(buf, "DL %x %x %x %x %x %x", &l->tick, &l->id,
+            &l->suppressed, &a0, &a1, &a2) == 6)
+        {
+            l->args[0] = a0;
+            l->args[1] = a1;
+            l->args[2] = a2;
+            n_lines++;
+        }
+    }
+    fclose(tmp);
+}
+
+
+static void test_order_and_args(void)
+{
+    host_time_us = 1234 * 10000;
+
+    DLOG(DLOG_WIFI_RETRY);
+    DLOG1(DLOG_WIFI_EVENT, 7);
+    DLOG3(DLOG_I2C_BUS_STATS, 12, -3, 65536);
+    flush_capture();
+
+    CHECK(n_lines == 3);
+    CHECK(lines[0].id == DLOG_WIFI_RETRY && lines[0].tick == 1234);
+    CHECK(lines[1].id == DLOG_WIFI_EVENT && lines[1].args[0] == 7);
+    CHECK(lines[2].id == DLOG_I2C_BUS_STATS);
+    CHECK(lines[2].args[0] == 12 && lines[2].args[1] == -3 && lines[2].args[2] == 65536);
+
+    /* Nothing left over */
+    flush_capture();
+    CHECK(n_lines == 0);
+}
+
+
+static void test_rate_limit_by_count(void)
+{
+    /* One per sample period, as "ltr390 trouble" is logged: the first, then
+     * one carrying the skipped count every DLOG_RATE_LIMIT_COUNT */
+    for (int i = 0; i < 25; i++)
+    {
+        host_advance_us(20000000);
+        DLOG(DLOG_LTR390_TROUBLE);
+    }
+    flush_capture();
+
+    CHECK(n_lines == 3);
+    CHECK(lines[0].id == DLOG_LTR390_TROUBLE && lines[0].suppressed == 0);
+    CHECK(lines[1].suppressed == DLOG_RATE_LIMIT_COUNT - 1);
+    CHECK(lines[2].suppressed == DLOG_RATE_LIMIT_COUNT - 1);
+
+    /* Ids are counted separately, and ones not marked are never limited */
+    for (int i = 0; i < 5; i++)
+    {
+        DLOG(DLOG_AM2301B_TROUBLE);
+        DLOG(DLOG_WIFI_RETRY);
+    }
+    flush_capture();
+
+    CHECK(n_lines == 6);
+    CHECK(lines[0].id == DLOG_AM2301B_TROUBLE && lines[1].id == DLOG_WIFI_RETRY);
+    for (int i = 2; i < n_lines; i++)
+        CHECK(lines[i].id == DLOG_WIFI_RETRY);
+}
+
+
+static void test_quiet_gap(void)
+{
+    /* Repeats held back by the test above are reported once quiet */
+    host_advance_us(DLOG_RATE_LIMIT_QUIET_MS * 1000LL);
+    flush_capture();
+    CHECK(n_lines == 2);
+    CHECK(lines[0].id == DLOG_QUIET && lines[0].args[0] == DLOG_AM2301B_TROUBLE);
+    CHECK(lines[0].args[1] == 4);
+    CHECK(lines[1].id == DLOG_QUIET && lines[1].args[0] == DLOG_LTR390_TROUBLE);
+    CHECK(lines[1].args[1] == 4);
+
+    /* A sporadic error, days apart: every occurrence is reported */
+    for (int i = 0; i < 3; i++)
+    {
+        host_advance_us(2LL * 24 * 3600 * 1000000);
+        DLOG(DLOG_PUBLISH_FAIL);
+        flush_capture();
+
+        CHECK(n_lines == 1);
+        CHECK(lines[0].id == DLOG_PUBLISH_FAIL && lines[0].suppressed == 0);
+    }
+
+    /* A burst, then quiet: the held back repeats are reported once the
+     * quiet time has passed, and the next burst starts afresh */
+    host_advance_us(DLOG_RATE_LIMIT_QUIET_MS * 1000LL);
+    for (int i = 0; i < 5; i++)
+    {
+        host_advance_us(20000000);
+        DLOG1(DLOG_MQTT_ERROR, i);
+    }
+    flush_capture();
+    CHECK(n_lines == 1);
+    CHECK(lines[0].id == DLOG_MQTT_ERROR && lines[0].args[0] == 0);
+
+    host_advance_us(DLOG_RATE_LIMIT_QUIET_MS * 1000LL - 1);
+    flush_capture();
+    CHECK(n_lines == 0);
+
+    host_advance_us(20000000);
+    flush_capture();
+    CHECK(n_lines == 1);
+    CHECK(lines[0].id == DLOG_QUIET);
+    CHECK(lines[0].args[0] == DLOG_MQTT_ERROR && lines[0].args[1] == 4);
+
+    DLOG1(DLOG_MQTT_ERROR, 9);
+    flush_capture();
+    CHECK(n_lines == 1);
+    CHECK(lines[0].id == DLOG_MQTT_ERROR && lines[0].args[0] == 9 && lines[0].suppressed == 0);
+}
+
+
+static void test_overflow(void)
+{
+    for (int i = 0; i < DLOG_RING_SIZE + 8; i++)
+        DLOG1(DLOG_WIFI_EVENT, i);
+    flush_capture();
+
+    /* Drop count first, then the records that fit, oldest first */
+    CHECK(n_lines == DLOG_RING_SIZE + 1);
+    CHECK(lines[0].id == DLOG_DROPPED && lines[0].args[0] == 8);
+    CHECK(lines[1].args[0] == 0);
+    CHECK(lines[DLOG_RING_SIZE].args[0] == DLOG_RING_SIZE - 1);
+}
+
+
+int main(void)
+{
+    test_order_and_args();
+    test_rate_limit_by_count();
+    test_quiet_gap();
+    test_overflow();
+
+    return HOST_TEST_RESULT("test_dlog");
+}
@@ -0,0 +1,109 @@
+/* Bus manager and sensor drivers on the virtual bus: timeouts sized to the
+ * transfer, utilization counters, and the sample cycle with the AM2301B
+ * conversion run sequentially against overlapped with the LTR390. */
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/i2c.h"
+#include "i2c_helpers.h"
+#include "i2c_bus.h"
+#include "am2301b.h"
+#include "ltr390.h"
+#include "fake_i2c.h"
+#include "host_test.h"
+
+
+#define SAMPLES                 100
+
+
+static char hum[25], tmp[25], als[25], uvs[25];
+
+
+static void sample_sequential(void)
+{
+    CHECK(am2301b_trigger_measurement(hum, tmp) == I2C_OK);
+    CHECK(ltr390_trigger_measurement(als, uvs) == I2C_OK);
+}
+
+
+static void sample_overlapped(void)
+{
+    int64_t started;
+
+    CHECK(am2301b_start_measurement() == I2C_OK);
+    started = host_time_us;
+
+    CHECK(ltr390_trigger_measurement(als, uvs) == I2C_OK);
+
+    if (host_time_us - started < AM2301B_MEAS_TIME_MS * 1000)
+        vTaskDelay((AM2301B_MEAS_TIME_MS * 1000 - (host_time_us - started)) / 1000 / portTICK_PERIOD_MS + 1);
+
+    CHECK(am2301b_read_measurement(hum, tmp) == I2C_OK);
+}
+
+
+static void run(const char *name, void (*sample)(void), int64_t *cycle_us)
+{
+    i2c_bus_stats_t stats;
+    int64_t start;
+
+    i2c_bus_get_stats(&stats);
+    start = host_time_us;
+
+    for (int i = 0; i < SAMPLES; i++)
+        sample();
+
+    i2c_bus_get_stats(&stats);
+    *cycle_us = (host_time_us - start) / SAMPLES;
+
+    printf("  %-11s %4lld ms per sample, %2u transactions, %4lld us busy, %u permille utilization\n",
+        name, (long long)(*cycle_us / 1000), stats.transactions / SAMPLES,
+        (long long)(stats.busy_us / SAMPLES), i2c_bus_utilization(&stats));
+
+    CHECK(stats.transactions == SAMPLES * 10);
+    CHECK(stats.errors == 0);
+}
+
+
+static void test_timeouts(void)
+{
+    uint8_t reg;
+
+    /* 4-byte register read: 39 bits at 100 kHz is under 1 ms, so the
+     * timeout is the 10 ms margin rounded up, not the old 1000 ms */
+    i2c_read_byte(0x53, 0x0d, &reg);
+    CHECK(fake_i2c.last_bytes == 4);
+    CHECK(fake_i2c.last_timeout == (1 + I2C_BUS_MARGIN_MS) / portTICK_PERIOD_MS + 1);
+    CHECK(fake_i2c.last_timeout < 1000 / portTICK_PERIOD_MS);
+
+    /* Longer transfers get longer timeouts */
+    uint8_t buf[200] = { 0 };
+    i2c_write_buf(0x53, buf, sizeof(buf));
+    CHECK(fake_i2c.last_bytes == 201);
+    CHECK(fake_i2c.last_timeout == (19 + I2C_BUS_MARGIN_MS) / portTICK_PERIOD_MS + 1);
+}
+
+
+int main(void)
+{
+    int64_t seq_us, ovl_us;
+
+    i2c_bus_init();
+
+    /* Status byte with the calibrated bits set */
+    fake_i2c.read_fill = AM2301B_STATUS_OK;
+    CHECK(am2301b_init() == I2C_OK);
+    fake_i2c.read_fill = 0;
+
+    test_timeouts();
+
+    run("sequential", sample_sequential, &seq_us);
+    run("overlapped", sample_overlapped, &ovl_us);
+
+    printf("  overlapping the AM2301B conversion saves %lld ms per sample\n",
+        (long long)((seq_us - ovl_us) / 1000));
+    CHECK(ovl_us < seq_us);
+
+    return HOST_TEST_RESULT("test_i2c_bus");
+}
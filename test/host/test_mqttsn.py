@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""MQTT-SN client against the gateway stand-in, then a latency and
+bytes-on-air comparison with QoS 1 MQTT over TCP.
+
+    python3 test_mqttsn.py build/test_mqttsn_client
+"""
+
+import subprocess
+import sys
+
+from mqttsn_gateway import (Broker, Gateway, CONNECT, PINGREQ, PUBLISH)
+
+FLAG_DUP = 0x80
+IP_UDP = 20 + 8
+IP_TCP = 20 + 20
+
+failures = 0
+
+
+def check(cond, what):
+    global failures
+    if not cond:
+        print('  FAIL: ' + what)
+        failures += 1
+
+
+def run(client, scenario, gw, *args):
+    return subprocess.run([client, scenario, str(gw.port)] + [str(a) for a in args],
+                          capture_output=True, text=True, timeout=30)
+
+
+def scenario(client, name, check_fn, **gw_args):
+    gw = Gateway(**gw_args)
+    gw.start()
+    res = run(client, name, gw)
+    gw.stop()
+    check(res.returncode == 0, '%s: client exit %d\n%s' % (name, res.returncode, res.stderr))
+    check_fn(gw.packets)
+
+
+def test_qos1_dup(pkts):
+    # CONNECT, PUBLISH (dropped), PUBLISH with DUP and the same msg id
+    check([p[1] for p in pkts] == [CONNECT, PUBLISH, PUBLISH], 'qos1: packet sequence %s' % pkts)
+    if len(pkts) == 3:
+        check(pkts[0][3] == 0x01, 'qos1: protocol id')
+        check(pkts[1][2] == 0x21 and pkts[2][2] == 0x21 | FLAG_DUP, 'qos1: DUP flag on retransmit')
+        check(pkts[1][5:7] == pkts[2][5:7], 'qos1: same msg id on retransmit')
+        check(pkts[1][3:5] == b'\x00\x03', 'qos1: topic id')
+
+
+def test_qosm1(pkts):
+    # No session, one PUBLISH with QoS -1 and pre-defined topic id
+    check([p[1] for p in pkts] == [PUBLISH], 'qosm1: packet sequence %s' % pkts)
+    if pkts:
+        check(pkts[0][2] == 0x61, 'qosm1: flags')
+        check(pkts[0][0] == len(pkts[0]), 'qosm1: length byte')
+
+
+def test_reopen(pkts):
+    check([p[1] for p in pkts] == [CONNECT, PUBLISH], 'reopen: packet sequence %s' % pkts)
+
+
+def test_ping(pkts):
+    check([p[1] for p in pkts] == [CONNECT, PUBLISH, PINGREQ, PUBLISH],
+          'ping: packet sequence %s' % pkts)
+
+
+def test_rejoin(pkts):
+    check([p[1] for p in pkts] == [CONNECT, PUBLISH, CONNECT, PUBLISH],
+          'rejoin: packet sequence %s' % pkts)
+
+
+def bench(client, n=200):
+    gw = Gateway()
+    gw.start()
+    sn = dict(l.split() for l in run(client, 'bench_sn', gw, n).stdout.split('\n') if l)
+    gw.stop()
+
+    broker = Broker()
+    broker.start()
+    res = subprocess.run([client, 'bench_tcp', str(broker.port), str(n)],
+                         capture_output=True, text=True, timeout=60)
+    broker.stop()
+    tcp = dict(l.split() for l in res.stdout.split('\n') if l)
+
+    check('sn_qos1_us' in sn and 'tcp_cold_us' in tcp, 'bench: both paths ran')
+    if failures:
+        return
+
+    pub = int(sn['sn_publish_len'])
+    tpub = int(tcp['tcp_publish_len'])
+    tcon = int(tcp['tcp_connect_len'])
+
+    # IP and transport headers included. The TCP session also needs a
+    # handshake (3 segments) and an ACK per data segment.
+    rows = [
+        ('MQTT-SN QoS -1', sn['sn_qosm1_us'], pub + IP_UDP),
+        ('MQTT-SN QoS 1', sn['sn_qos1_us'], pub + IP_UDP + 7 + IP_UDP),
+        ('MQTT/TCP QoS 1, open session', tcp['tcp_warm_us'], tpub + IP_TCP + 4 + IP_TCP + IP_TCP),
+        ('MQTT/TCP QoS 1, new session', tcp['tcp_cold_us'],
+         3 * IP_TCP + tcon + IP_TCP + 4 + IP_TCP + tpub + IP_TCP + 4 + IP_TCP + IP_TCP),
+    ]
+
+    print('  loopback, %d publishes of a %d byte payload' % (n, pub - 7))
+    print('  %-32s %10s %14s' % ('path', 'latency us', 'bytes on air'))
+    for name, lat, size in rows:
+        print('  %-32s %10s %14d' % (name, lat, size))
+
+
+def main():
+    client = sys.argv[1]
+
+    scenario(client, 'qos1', test_qos1_dup, drop_publishes=1)
+    scenario(client, 'qosm1', test_qosm1)
+    scenario(client, 'reopen', test_reopen)
+    scenario(client, 'ping', test_ping)
+    # A runt datagram is skipped, the PINGRESP after it still counts
+    scenario(client, 'ping', test_ping, runt_pings=True)
+    scenario(client, 'rejoin', test_rejoin, reject_publishes=1)
+    bench(client)
+
+    print('test_mqttsn: %s' % ('FAIL' if failures else 'ok'))
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,187 @@
+/* MQTT-SN client side of test_mqttsn.py. Runs one scenario against the
+ * gateway stand-in on the given port and exits 0 if it behaved. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "freertos/FreeRTOS.h"
+#include "lwip/netdb.h"
+#include "mqttsn.h"
+
+
+#define PAYLOAD                 "{\"value\":23.500000,\"ts\":1760000000.123}"
+#define TCP_TOPIC               "home/humidity/office"
+
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+static int publish(int8_t qos, uint16_t topic_id)
+{
+    mqttsn_topic_t topic;
+
+    mqttsn_topic_init(&topic, topic_id, qos);
+    return mqttsn_publish(&topic, PAYLOAD, strlen(PAYLOAD));
+}
+
+
+/* Cold and warm QoS 1 publish over plain MQTT 3.1.1 on TCP, the path the
+ * TCP client takes, for comparison */
+static int bench_tcp(uint16_t port, int n)
+{
+    uint8_t connect_pkt[] = {
+        0x10, 12 + 3, 0, 4, 'M', 'Q', 'T', 'T', 4, 0x02, 0, 120, 0, 3, 'c', 'l', 'i',
+    };
+    uint8_t pub[128];
+    uint8_t rx[4];
+    size_t topic_len = strlen(TCP_TOPIC), payload_len = strlen(PAYLOAD);
+    size_t len = 0;
+    int64_t cold = 0, warm = 0, t0;
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port) };
+    int one = 1;
+
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+
+    pub[len++] = 0x32;
+    pub[len++] = 2 + topic_len + 2 + payload_len;
+    pub[len++] = 0;
+    pub[len++] = topic_len;
+    memcpy(&pub[len], TCP_TOPIC, topic_len);
+    len += topic_len;
+    pub[len++] = 0;
+    pub[len++] = 1;
+    memcpy(&pub[len], PAYLOAD, payload_len);
+    len += payload_len;
+
+    for (int i = 0; i < n; i++)
+    {
+        t0 = now_us();
+
+        int s = socket(AF_INET, SOCK_STREAM, 0);
+        setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (connect(s, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+            return 1;
+        send(s, connect_pkt, sizeof(connect_pkt), 0);
+        if (recv(s, rx, 4, MSG_WAITALL) != 4 || rx[0] != 0x20)
+            return 1;
+        send(s, pub, len, 0);
+        if (recv(s, rx, 4, MSG_WAITALL) != 4 || rx[0] != 0x40)
+            return 1;
+
+        cold += now_us() - t0;
+
+        t0 = now_us();
+        send(s, pub, len, 0);
+        if (recv(s, rx, 4, MSG_WAITALL) != 4 || rx[0] != 0x40)
+            return 1;
+        warm += now_us() - t0;
+
+        close(s);
+    }
+
+    printf("tcp_cold_us %lld\n", (long long)(cold / n));
+    printf("tcp_warm_us %lld\n", (long long)(warm / n));
+    printf("tcp_publish_len %zu\n", len);
+    printf("tcp_connect_len %zu\n", sizeof(connect_pkt));
+
+    return 0;
+}
+
+
+static int bench_sn(uint16_t port, int n)
+{
+    int64_t t0, qos1 = 0, qosm1 = 0;
+
+    if (mqttsn_init("127.0.0.1", port, "cli", MQTTSN_QOS_AT_LEAST_1) != MQTTSN_OK)
+        return 1;
+
+    for (int i = 0; i < n; i++)
+    {
+        t0 = now_us();
+        if (publish(MQTTSN_QOS_AT_LEAST_1, 1) != MQTTSN_OK)
+            return 1;
+        qos1 += now_us() - t0;
+
+        t0 = now_us();
+        if (publish(MQTTSN_QOS_FIRE_FORGET, 1) != MQTTSN_OK)
+            return 1;
+        qosm1 += now_us() - t0;
+    }
+
+    printf("sn_qos1_us %lld\n", (long long)(qos1 / n));
+    printf("sn_qosm1_us %lld\n", (long long)(qosm1 / n));
+    printf("sn_publish_len %zu\n", MQTTSN_PUB_HDR_LEN + strlen(PAYLOAD));
+
+    return 0;
+}
+
+
+int main(int argc, char **argv)
+{
+    const char *scenario = argv[1];
+    uint16_t port = atoi(argv[2]);
+
+    if (strcmp(scenario, "qos1") == 0)
+    {
+        if (mqttsn_init("127.0.0.1", port, "cli", MQTTSN_QOS_AT_LEAST_1) != MQTTSN_OK)
+            return 1;
+        return publish(MQTTSN_QOS_AT_LEAST_1, 3) != MQTTSN_OK;
+    }
+
+    if (strcmp(scenario, "qosm1") == 0)
+    {
+        if (mqttsn_init("127.0.0.1", port, "cli", MQTTSN_QOS_FIRE_FORGET) != MQTTSN_OK)
+            return 1;
+        return publish(MQTTSN_QOS_FIRE_FORGET, 4) != MQTTSN_OK;
+    }
+
+    if (strcmp(scenario, "reopen") == 0)
+    {
+        /* DNS not up at boot, init fails but the next publish recovers */
+        host_getaddrinfo_fail = 1;
+        if (mqttsn_init("localhost", port, "cli", MQTTSN_QOS_AT_LEAST_1) == MQTTSN_OK)
+            return 1;
+        return publish(MQTTSN_QOS_AT_LEAST_1, 2) != MQTTSN_OK;
+    }
+
+    if (strcmp(scenario, "ping") == 0)
+    {
+        if (mqttsn_init("127.0.0.1", port, "cli", MQTTSN_QOS_AT_LEAST_1) != MQTTSN_OK)
+            return 1;
+        if (publish(MQTTSN_QOS_AT_LEAST_1, 1) != MQTTSN_OK)
+            return 1;
+
+        /* Idle for longer than the keep-alive */
+        host_advance_us((CONFIG_MQTTSN_KEEPALIVE_S + 1) * 1000000LL);
+
+        return publish(MQTTSN_QOS_AT_LEAST_1, 1) != MQTTSN_OK;
+    }
+
+    if (strcmp(scenario, "rejoin") == 0)
+    {
+        if (mqttsn_init("127.0.0.1", port, "cli", MQTTSN_QOS_AT_LEAST_1) != MQTTSN_OK)
+            return 1;
+        return publish(MQTTSN_QOS_AT_LEAST_1, 1) != MQTTSN_OK;
+    }
+
+    if (strcmp(scenario, "bench_sn") == 0)
+        return bench_sn(port, atoi(argv[3]));
+
+    if (strcmp(scenario, "bench_tcp") == 0)
+        return bench_tcp(port, atoi(argv[3]));
+
+    fprintf(stderr, "unknown scenario %s\n", scenario);
+    return 2;
+}
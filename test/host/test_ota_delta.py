@@ -0,0 +1,240 @@
+#!/usr/bin/env python3
+"""Delta OTA streaming apply path against a lossy, reordering broker
+stand-in, driven by the go-back-N sender from tools/ota_delta.py.
+
+    python3 test_ota_delta.py build/test_ota_delta_device KEY build/test_ota_delta_nokey
+"""
+
+import os
+import random
+import struct
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', 'tools'))
+import ota_delta  # noqa: E402
+
+CHUNK = 64          # Header spans two chunks
+WINDOW = 8
+LATENCY = 4         # Chunks in flight before the first is delivered
+
+failures = 0
+
+
+def check(cond, what):
+    global failures
+    if not cond:
+        print('  FAIL: ' + what)
+        failures += 1
+
+
+class Broker:
+    """In-order channel with LATENCY chunks in flight. Drops a fraction of
+    the published chunks, and lets a fraction overtake the one before."""
+
+    def __init__(self, loss=0.0, reorder=0.0, seed=1):
+        self.loss = loss
+        self.reorder = reorder
+        self.rng = random.Random(seed)
+        self.queue = []
+        self.published = 0
+
+    def publish(self, payload):
+        self.published += 1
+        if self.rng.random() < self.loss:
+            return
+        if self.queue and self.rng.random() < self.reorder:
+            self.queue.insert(len(self.queue) - 1, payload)
+        else:
+            self.queue.append(payload)
+
+    def deliver(self, drain):
+        """Oldest chunk once the pipe is full, or any left when draining."""
+        if self.queue and (drain or len(self.queue) > LATENCY):
+            return self.queue.pop(0)
+        return None
+
+
+class Device:
+    def __init__(self, binary, base, tmp):
+        self.base = os.path.join(tmp, 'base.bin')
+        self.out = os.path.join(tmp, 'out.bin')
+        open(self.base, 'wb').write(base)
+        self.proc = subprocess.Popen([binary, self.base, self.out],
+                                     stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+
+    def send(self, payload):
+        self.proc.stdin.write(struct.pack('<I', len(payload)) + payload)
+        self.proc.stdin.flush()
+        return self.proc.stdout.readline().decode().strip()
+
+    def finish(self):
+        """Image in the update partition and the OTA call counts."""
+        self.proc.stdin.close()
+        counts = self.proc.stdout.readline().decode().split()
+        self.proc.wait(timeout=10)
+        return open(self.out, 'rb').read(), dict(zip(counts[::2], map(int, counts[1::2])))
+
+
+def transfer(dev, patch, broker, max_steps=100000):
+    """Alternate publishes and acks the way send_patch() runs: each step
+    publishes at most one chunk and handles at most one status message."""
+    sender = ota_delta.Sender(patch, CHUNK, WINDOW)
+    for _ in range(max_steps):
+        if sender.status is not None:
+            break
+        payload = sender.next_chunk()
+        if payload is not None:
+            broker.publish(payload)
+        chunk = broker.deliver(drain=payload is None)
+        if chunk is not None:
+            sender.on_status(dev.send(chunk))
+        elif payload is None:
+            # Window full and nothing in flight, the ack timeout fires
+            sender.timeout()
+    return sender
+
+
+def chunk_of(patch, seq):
+    return struct.pack('<I', seq) + patch[seq * CHUNK:(seq + 1) * CHUNK]
+
+
+def images(seed):
+    rng = random.Random(seed)
+    base = bytes(rng.getrandbits(8) for _ in range(96 * 1024))
+    new = bytearray(base)
+    for off in (1000, 30000, 70000):
+        new[off:off + 200] = bytes(rng.getrandbits(8) for _ in range(200))
+    new[50000:50000] = bytes(rng.getrandbits(8) for _ in range(12 * 1024))
+    return base, bytes(new)
+
+
+def main():
+    binary, key, nokey_binary = sys.argv[1], sys.argv[2].encode(), sys.argv[3]
+    base, new = images(1)
+    other_base, other_new = images(2)
+    patch = ota_delta.make_patch(base, new, key)
+    n_chunks = (len(patch) + CHUNK - 1) // CHUNK
+
+    def run(name, body):
+        with tempfile.TemporaryDirectory() as tmp:
+            body(tmp)
+
+    # Clean stream
+    def clean(tmp):
+        dev = Device(binary, base, tmp)
+        sender = transfer(dev, patch, Broker())
+        image, counts = dev.finish()
+        check(sender.status == 'done', 'clean: status %s' % sender.status)
+        check(image[:len(new)] == new, 'clean: image differs')
+        check(counts['begins'] == 1 and counts['boot'] == 1, 'clean: %s' % counts)
+    run('clean', clean)
+
+    # Loss and reordering, with a bound on the resend overhead. Go-back-N
+    # costs about the chunks in flight per loss, and the same per chunk
+    # that overtakes another, since the device drops it
+    for loss, reorder, bound in ((0.01, 0, 1.15), (0.05, 0, 1.5), (0.2, 0, 4.0),
+                                 (0.05, 0.05, 2.0)):
+        def lossy(tmp):
+            name = '%d%% loss, %d%% reordered' % (loss * 100, reorder * 100)
+            dev = Device(binary, base, tmp)
+            broker = Broker(loss=loss, reorder=reorder, seed=3)
+            sender = transfer(dev, patch, broker)
+            image, counts = dev.finish()
+            ratio = broker.published / n_chunks
+            check(sender.status == 'done', '%s: status %s' % (name, sender.status))
+            check(image[:len(new)] == new, '%s: image differs' % name)
+            check(counts['begins'] == 1 and counts['boot'] == 1, '%s: %s' % (name, counts))
+            check(ratio < bound, '%s: %.2fx resent, bound %.2fx' % (name, ratio, bound))
+            print('  %-24s %d chunks published for %d (%.2fx)'
+                  % (name + ':', broker.published, n_chunks, ratio))
+        run('lossy', lossy)
+
+    # Duplicate seq 0 mid-update is dropped, not a restart
+    def dup_mid(tmp):
+        dev = Device(binary, base, tmp)
+        for seq in range(5):
+            dev.send(chunk_of(patch, seq))
+        check(dev.send(chunk_of(patch, 0)) == 'ack 5 0', 'dup 0 mid-update: not acked as duplicate')
+        for seq in range(5, n_chunks):
+            status = dev.send(chunk_of(patch, seq))
+        image, counts = dev.finish()
+        check(status == 'done', 'dup 0 mid-update: status %s' % status)
+        check(image[:len(new)] == new, 'dup 0 mid-update: image differs')
+        check(counts['begins'] == 1, 'dup 0 mid-update: %s' % counts)
+    run('dup_mid', dup_mid)
+
+    # A different header mid-update restarts with the new patch
+    def restart(tmp):
+        patch2 = ota_delta.make_patch(base, new[:-4096], key)
+        dev = Device(binary, base, tmp)
+        for seq in range(5):
+            dev.send(chunk_of(patch, seq))
+        check(dev.send(chunk_of(patch2, 0)) == 'ack 1 0', 'restart: new header not accepted')
+        sender = transfer(dev, patch2, Broker())
+        image, counts = dev.finish()
+        check(sender.status == 'done', 'restart: status %s' % sender.status)
+        check(image[:len(new) - 4096] == new[:-4096], 'restart: image differs')
+        check(counts['begins'] == 2, 'restart: %s' % counts)
+    run('restart', restart)
+
+    # After DONE nothing, not even a new update, touches the verified image
+    def after_done(tmp):
+        dev = Device(binary, base, tmp)
+        transfer(dev, patch, Broker())
+        other = ota_delta.make_patch(base, other_new, key)
+        statuses = [dev.send(chunk_of(patch, 0)), dev.send(chunk_of(patch, 3)),
+                    dev.send(chunk_of(other, 0)), dev.send(chunk_of(other, 1))]
+        image, counts = dev.finish()
+        check(statuses == ['done'] * 4, 'after done: %s' % statuses)
+        check(image[:len(new)] == new, 'after done: verified image erased')
+        check(counts['begins'] == 1 and counts['boot'] == 1, 'after done: %s' % counts)
+    run('after_done', after_done)
+
+    # Patches the device must refuse before erasing anything
+    refused = {
+        'wrong key': ota_delta.make_patch(base, new, b'not-the-key'),
+        'other base': ota_delta.make_patch(other_base, new, key),
+        'empty key': ota_delta.make_patch(base, new, b''),
+    }
+    forged = bytearray(patch)
+    forged[8] ^= 1          # New image hash, covered by the HMAC
+    refused['forged header'] = bytes(forged)
+    for name, bad in refused.items():
+        def reject(tmp):
+            dev = Device(binary, base, tmp)
+            status = [dev.send(chunk_of(bad, 0)), dev.send(chunk_of(bad, 1))]
+            _, counts = dev.finish()
+            check(status[1] == 'error', '%s: status %s' % (name, status))
+            check(counts['begins'] == 0 and counts['boot'] == -1, '%s: %s' % (name, counts))
+        run(name, reject)
+
+    # A device built without a key refuses even a patch signed with the
+    # empty key, which would otherwise verify
+    def nokey(tmp):
+        dev = Device(nokey_binary, base, tmp)
+        unsigned = ota_delta.make_patch(base, new, b'')
+        status = [dev.send(chunk_of(unsigned, 0)), dev.send(chunk_of(unsigned, 1))]
+        _, counts = dev.finish()
+        check(status[1] == 'error', 'no key: status %s' % status)
+        check(counts['begins'] == 0 and counts['boot'] == -1, 'no key: %s' % counts)
+    run('nokey', nokey)
+
+    # Corrupt body: written, but the image hash stops the partition switch
+    def corrupt(tmp):
+        bad = bytearray(patch)
+        bad[-10] ^= 1
+        dev = Device(binary, base, tmp)
+        sender = transfer(dev, bytes(bad), Broker())
+        _, counts = dev.finish()
+        check(sender.status == 'error', 'corrupt body: status %s' % sender.status)
+        check(counts['boot'] == -1, 'corrupt body: %s' % counts)
+    run('corrupt', corrupt)
+
+    print('test_ota_delta: %s' % ('FAIL' if failures else 'ok'))
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
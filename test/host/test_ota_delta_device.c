@@ -0,0 +1,72 @@
+/* ota_delta on the host, driven by test_ota_delta.py. Chunks arrive on
+ * stdin as a length (u32 little endian) and payload, and each gets the
+ * status line main.c would publish. At end of input the update partition
+ * is written out, then the OTA call counts are printed.
+ *
+ *  test_ota_delta_device base.bin out.bin
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_ota.h"
+#include "ota_delta.h"
+
+
+static uint8_t chunk[4096];
+
+
+int main(int argc, char **argv)
+{
+    uint8_t len_buf[4];
+    uint32_t len;
+    uint32_t next_seq;
+    uint32_t seq;
+    FILE *f;
+    int ret;
+
+    if (argc != 3)
+    {
+        fprintf(stderr, "usage: %s base.bin out.bin\n", argv[0]);
+        return 2;
+    }
+
+    memset(host_ota.flash, 0xff, sizeof(host_ota.flash));
+
+    f = fopen(argv[1], "rb");
+    if (f == NULL)
+        return 2;
+    fread(host_ota.flash[host_ota.running], 1, HOST_OTA_PART_SIZE, f);
+    fclose(f);
+
+    while (fread(len_buf, 1, sizeof(len_buf), stdin) == sizeof(len_buf))
+    {
+        len = len_buf[0] | (len_buf[1] << 8) | (len_buf[2] << 16) | ((uint32_t)len_buf[3] << 24);
+        if (len > sizeof(chunk) || fread(chunk, 1, len, stdin) != len)
+            return 2;
+
+        ret = ota_delta_handle_chunk(chunk, len, &next_seq);
+
+        seq = 0;
+        if (len >= OTA_DELTA_SEQ_LEN)
+            seq = chunk[0] | (chunk[1] << 8) | (chunk[2] << 16) | ((uint32_t)chunk[3] << 24);
+
+        if (ret == OTA_DELTA_DONE)
+            printf("done\n");
+        else if (ret == OTA_DELTA_FAIL)
+            printf("error\n");
+        else
+            printf("ack %u %u\n", (unsigned)next_seq, (unsigned)seq);
+        fflush(stdout);
+    }
+
+    f = fopen(argv[2], "wb");
+    if (f == NULL)
+        return 2;
+    fwrite(host_ota.flash[!host_ota.running], 1, HOST_OTA_PART_SIZE, f);
+    fclose(f);
+
+    printf("begins %d ends %d boot %d\n", host_ota.begins, host_ota.ends, host_ota.boot);
+
+    return 0;
+}
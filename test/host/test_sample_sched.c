@@ -0,0 +1,160 @@
+/* Sample schedule against a virtual clock: 24 simulated hours of sampling
+ * with variable work time and preemption must stay on the period grid. */
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sample_sched.h"
+#include "host_test.h"
+
+
+#define DAY_MS                  (24LL * 3600 * 1000)
+
+
+/**
+ * @brief Run the sample loop for a simulated day.
+ * 
+ * @param period_ms     Sample period
+ * @param work_max_ms   Upper bound on time spent sampling and publishing
+ * @param preempt_max_ms Upper bound on preemption between reading the tick
+ *                      count and going to sleep
+ * @param max_jitter_ms Where to store the worst wake-up error
+ * @return long Number of samples taken
+ */
+static long run_day(uint32_t period_ms, int work_max_ms, int preempt_max_ms, int64_t *max_jitter_ms)
+{
+    sample_sched_t sched;
+    TickType_t wake;
+    int64_t start_us, expected_us, jitter_us;
+    long samples = 0;
+
+    host_time_us = 12345678;    // Not on a tick or period boundary
+    vTaskDelay(0);
+    start_us = host_time_us;
+    *max_jitter_ms = 0;
+
+    wake = xTaskGetTickCount();
+    sample_sched_init(&sched, wake, period_ms, portTICK_PERIOD_MS);
+
+    while (host_time_us - start_us < DAY_MS * 1000)
+    {
+        /* Each wake-up should sit on start + n * period, within one tick */
+        expected_us = start_us + (int64_t)samples * period_ms * 1000;
+        jitter_us = host_time_us - expected_us;
+        if (jitter_us < 0)
+            jitter_us = -jitter_us;
+        if (jitter_us / 1000 > *max_jitter_ms)
+            *max_jitter_ms = jitter_us / 1000;
+
+        samples++;
+
+        host_advance_us((rand() % (work_max_ms + 1)) * 1000LL);
+
+        uint32_t increment = sample_sched_next(&sched, xTaskGetTickCount());
+
+        if (preempt_max_ms)
+            host_advance_us((rand() % (preempt_max_ms + 1)) * 1000LL);
+
+        vTaskDelayUntil(&wake, increment);
+    }
+
+    return samples;
+}
+
+
+static void test_day_jitter(void)
+{
+    int64_t jitter;
+    long samples;
+
+    srand(1);
+
+    /* 20 s period, up to 900 ms of work per sample */
+    samples = run_day(20000, 900, 0, &jitter);
+    printf("  20000 ms period: %ld samples in 24 h, max jitter %lld ms\n", samples, (long long)jitter);
+    CHECK(samples == DAY_MS / 20000);
+    CHECK(jitter <= portTICK_PERIOD_MS);
+
+    /* Preemption between reading the tick and sleeping must not move the
+     * wake-up, the sleep is to an absolute tick */
+    samples = run_day(20000, 900, 50, &jitter);
+    printf("  with 50 ms preemption: max jitter %lld ms\n", (long long)jitter);
+    CHECK(samples == DAY_MS / 20000);
+    CHECK(jitter <= portTICK_PERIOD_MS);
+
+    /* Period that is not a whole number of ticks */
+    samples = run_day(20005, 900, 0, &jitter);
+    printf("  20005 ms period: %ld samples in 24 h, max jitter %lld ms\n", samples, (long long)jitter);
+    CHECK(samples == (DAY_MS + 20004) / 20005);
+    CHECK(jitter <= portTICK_PERIOD_MS);
+}
+
+
+static void test_naive_delay_drifts(void)
+{
+    /* For reference, the old vTaskDelay(period) after the work */
+    int64_t start_us = host_time_us = 0;
+    long samples = 0;
+
+    srand(1);
+    while (host_time_us - start_us < DAY_MS * 1000)
+    {
+        samples++;
+        host_advance_us((rand() % 901) * 1000LL);
+        vTaskDelay(20000 / portTICK_PERIOD_MS);
+    }
+
+    printf("  vTaskDelay(20000) for reference: %ld samples in 24 h (%ld short)\n",
+        samples, (long)(DAY_MS / 20000 - samples));
+    CHECK(samples < DAY_MS / 20000);
+}
+
+
+static void test_overrun_skips(void)
+{
+    sample_sched_t sched;
+
+    sample_sched_init(&sched, 1000, 20000, 10);
+
+    /* On time: next boundary is tick 3000 */
+    CHECK(sample_sched_next(&sched, 1500) == 2000);
+    CHECK(sched.target == 3000);
+
+    /* Woke at 3000 but took 2.5 periods, next boundary is 9000 */
+    CHECK(sample_sched_next(&sched, 8000) == 6000);
+    CHECK(sched.target == 9000);
+
+    /* Landing exactly on a boundary skips to the following one */
+    CHECK(sample_sched_next(&sched, 11000) == 4000);
+    CHECK(sched.target == 13000);
+}
+
+
+static void test_tick_wrap(void)
+{
+    sample_sched_t sched;
+    uint32_t now = 0xffffff00u;
+
+    sample_sched_init(&sched, now, 20000, 10);
+
+    for (int i = 0; i < 10; i++)
+    {
+        CHECK(sample_sched_next(&sched, now + 100) == 2000);
+        now += 2000;
+        CHECK(sched.target == now);
+    }
+
+    CHECK(now == 0xffffff00u + 10 * 2000);
+}
+
+
+int main(void)
+{
+    test_day_jitter();
+    test_naive_delay_drifts();
+    test_overrun_skips();
+    test_tick_wrap();
+
+    return HOST_TEST_RESULT("test_sample_sched");
+}
@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""Decode deferred log records from the serial console.
+
+Reads console output on stdin (e.g. piped from `make monitor` or a saved
+log), replaces raw "DL ..." record lines with formatted messages and
+passes every other line through unchanged.
+
+    python3 tools/dlog_decode.py < console.log
+"""
+
+import os
+import re
+import sys
+
+IDS_H = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                     '..', 'components', 'dlog', 'include', 'dlog_ids.h')
+
+DEF_RE = re.compile(r'^\s*DLOG_DEF\(\s*(\w+)\s*,\s*(\d)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+REC_RE = re.compile(r'DL ([0-9a-f]+) ([0-9a-f]+) ([0-9a-f]+) ([0-9a-f]+) ([0-9a-f]+) ([0-9a-f]+)')
+
+
+def load_table(path):
+    """Return [(name, format)] indexed by record id."""
+    table = []
+    with open(path) as f:
+        for line in f:
+            m = DEF_RE.match(line)
+            if m:
+                table.append((m.group(1), m.group(3)))
+    return table
+
+
+def to_int32(value):
+    return value - (1 << 32) if value & (1 << 31) else value
+
+
+def decode(line, table):
+    m = REC_RE.search(line)
+    if not m:
+        return line
+
+    tick, rec_id, suppressed, *args = (int(g, 16) for g in m.groups())
+    args = [to_int32(a) for a in args]
+
+    if rec_id >= len(table):
+        return '(%u) unknown record id %d %s' % (tick, rec_id, args)
+
+    name, fmt = table[rec_id]
+    nargs = len(re.findall(r'%[^%]', fmt.replace('%%', '')))
+    msg = '(%u) %s: %s' % (tick, name, fmt % tuple(args[:nargs]))
+    if suppressed:
+        msg += ' (+%d repeats)' % suppressed
+    return msg
+
+
+def main():
+    table = load_table(IDS_H)
+    for line in sys.stdin:
+        print(decode(line.rstrip('\n'), table))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,245 @@
+#!/usr/bin/env python3
+"""Make and send delta OTA patches for the ota_delta component.
+
+    python3 tools/ota_delta.py make --key KEY old.bin new.bin update.patch
+    python3 tools/ota_delta.py apply --key KEY old.bin update.patch out.bin
+    python3 tools/ota_delta.py send update.patch broker.local
+
+`make` reports the patch size against the full image. `apply` runs the
+patch the same way the device does, to check it before sending. `send`
+streams the patch over MQTT (needs paho-mqtt) and resends from the
+sequence number the device acks, so lost or reordered chunks are
+recovered. See components/ota_delta/include/ota_delta.h for the format.
+
+KEY must match CONFIG_OTA_DELTA_KEY in the device image. It can also be
+given in the OTA_DELTA_KEY environment variable, to keep it out of the
+shell history.
+"""
+
+import argparse
+import hashlib
+import hmac
+import os
+import struct
+import sys
+import time
+
+MAGIC = b'ADP2'
+MAC_OFFSET = 76
+HDR_LEN = MAC_OFFSET + 32
+OP_COPY = 0x01
+OP_INSERT = 0x02
+
+BLOCK = 16          # Match granularity when indexing the old image
+MIN_COPY = 24       # Shorter matches cost more as COPY than as literal
+
+
+def header_mac(key, header):
+    return hmac.new(key, header[:MAC_OFFSET], hashlib.sha256).digest()
+
+
+def make_patch(old, new, key):
+    index = {}
+    for i in range(len(old) - BLOCK + 1):
+        index.setdefault(old[i:i + BLOCK], i)
+
+    out = bytearray()
+    out += MAGIC
+    out += struct.pack('<I', len(new)) + hashlib.sha256(new).digest()
+    out += struct.pack('<I', len(old)) + hashlib.sha256(old).digest()
+    out += header_mac(key, out)
+
+    literal = bytearray()
+
+    def flush_literal():
+        if literal:
+            out.extend(struct.pack('<BI', OP_INSERT, len(literal)))
+            out.extend(literal)
+            literal.clear()
+
+    j = 0
+    while j < len(new):
+        src = index.get(new[j:j + BLOCK]) if j + BLOCK <= len(new) else None
+        length = 0
+        if src is not None:
+            length = BLOCK
+            while (j + length < len(new) and src + length < len(old)
+                   and new[j + length] == old[src + length]):
+                length += 1
+
+        if length >= MIN_COPY:
+            flush_literal()
+            out += struct.pack('<BII', OP_COPY, src, length)
+            j += length
+        else:
+            literal.append(new[j])
+            j += 1
+
+    flush_literal()
+    return bytes(out)
+
+
+def apply_patch(old, patch, key):
+    if patch[:4] != MAGIC:
+        raise ValueError('bad magic')
+    if not hmac.compare_digest(header_mac(key, patch), patch[MAC_OFFSET:HDR_LEN]):
+        raise ValueError('header not authenticated, wrong key?')
+    new_size, = struct.unpack_from('<I', patch, 4)
+    new_hash = patch[8:40]
+    base_size, = struct.unpack_from('<I', patch, 40)
+    if hashlib.sha256(old[:base_size]).digest() != patch[44:76]:
+        raise ValueError('base image mismatch')
+
+    out = bytearray()
+    p = HDR_LEN
+    while len(out) < new_size:
+        op = patch[p]
+        if op == OP_COPY:
+            src, length = struct.unpack_from('<II', patch, p + 1)
+            out += old[src:src + length]
+            p += 9
+        elif op == OP_INSERT:
+            length, = struct.unpack_from('<I', patch, p + 1)
+            out += patch[p + 5:p + 5 + length]
+            p += 5 + length
+        else:
+            raise ValueError('bad op %d at %d' % (op, p))
+
+    if hashlib.sha256(out).digest() != new_hash:
+        raise ValueError('image hash mismatch')
+    return bytes(out)
+
+
+class Sender:
+    """Go-back-N over the device status messages: keep up to `window`
+    chunks past the last ack in flight, and resend from where the device
+    is on a repeated ack or a timeout. Transport agnostic, so the host
+    test drives it against a lossy broker stand-in."""
+
+    def __init__(self, patch, chunk, window):
+        self.chunks = [patch[i:i + chunk] for i in range(0, len(patch), chunk)]
+        self.window = window
+        self.acked = 0
+        self.sent = 0
+        self.rewound_at = None
+        self.status = None
+
+    def on_status(self, text):
+        if not text.startswith('ack '):
+            self.status = text
+            return
+
+        # "ack <next expected> <sequence number received>"
+        fields = text.split()
+        acked = int(fields[1])
+        got = int(fields[2]) if len(fields) > 2 else None
+
+        if acked > self.acked:
+            self.acked = acked
+            self.sent = max(self.sent, acked)
+            self.rewound_at = None
+        elif got is not None and got < acked:
+            # Stale copy of a chunk the device already has, no gap
+            pass
+        elif acked == self.acked and acked != self.rewound_at and self.sent > acked:
+            # A repeated ack means a later chunk arrived ahead of a lost
+            # one. Every chunk still in flight repeats it too, so resend
+            # once per gap, not once per repeat
+            self.sent = acked
+            self.rewound_at = acked
+
+    def timeout(self):
+        """No ack for a while: resend from where the device is."""
+        self.sent = self.acked
+        self.rewound_at = None
+
+    def next_chunk(self):
+        """Next payload to publish, or None while the window is full."""
+        if self.sent < len(self.chunks) and self.sent < self.acked + self.window:
+            seq = self.sent
+            self.sent += 1
+            return struct.pack('<I', seq) + self.chunks[seq]
+        return None
+
+
+def send_patch(patch, host, port, topic, chunk, window, timeout):
+    import paho.mqtt.client as mqtt
+
+    sender = Sender(patch, chunk, window)
+    last = [time.time()]
+
+    def on_message(client, userdata, msg):
+        sender.on_status(msg.payload.decode(errors='replace'))
+        last[0] = time.time()
+
+    client = mqtt.Client()
+    client.on_message = on_message
+    client.connect(host, port)
+    client.subscribe(topic + '/status', qos=1)
+    client.loop_start()
+
+    while sender.status is None:
+        if time.time() - last[0] > timeout:
+            sender.timeout()
+            last[0] = time.time()
+        payload = sender.next_chunk()
+        if payload is not None:
+            client.publish(topic + '/patch', payload, qos=1)
+        else:
+            time.sleep(0.05)
+
+    client.loop_stop()
+    print(sender.status)
+    return 0 if sender.status == 'done' else 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest='cmd', required=True)
+
+    p = sub.add_parser('make')
+    p.add_argument('--key', default=os.environ.get('OTA_DELTA_KEY'))
+    p.add_argument('old')
+    p.add_argument('new')
+    p.add_argument('patch')
+
+    p = sub.add_parser('apply')
+    p.add_argument('--key', default=os.environ.get('OTA_DELTA_KEY'))
+    p.add_argument('old')
+    p.add_argument('patch')
+    p.add_argument('out')
+
+    p = sub.add_parser('send')
+    p.add_argument('patch')
+    p.add_argument('host')
+    p.add_argument('--port', type=int, default=1883)
+    p.add_argument('--topic', default='home/ota/office')
+    p.add_argument('--chunk', type=int, default=512)
+    p.add_argument('--window', type=int, default=8)
+    p.add_argument('--timeout', type=float, default=5.0)
+
+    args = parser.parse_args()
+
+    if args.cmd in ('make', 'apply') and not args.key:
+        parser.error('--key or OTA_DELTA_KEY is required')
+
+    if args.cmd == 'make':
+        old = open(args.old, 'rb').read()
+        new = open(args.new, 'rb').read()
+        patch = make_patch(old, new, args.key.encode())
+        open(args.patch, 'wb').write(patch)
+        print('full image %d bytes, patch %d bytes (%.1f%%)'
+              % (len(new), len(patch), 100.0 * len(patch) / max(len(new), 1)))
+    elif args.cmd == 'apply':
+        old = open(args.old, 'rb').read()
+        patch = open(args.patch, 'rb').read()
+        open(args.out, 'wb').write(apply_patch(old, patch, args.key.encode()))
+    else:
+        patch = open(args.patch, 'rb').read()
+        sys.exit(send_patch(patch, args.host, args.port, args.topic,
+                            args.chunk, args.window, args.timeout))
+
+
+if __name__ == '__main__':
+    main()